@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "../src/resample.h"
+
+/*
+
+Speed and accuracy harness for the resampling stage (src/resample.cpp).
+
+Builds a skeleton whose bones have irregular, independent key times on every channel and
+resamples it at a fixed rate. The default is 150 bones at 60 fps over 5 minutes. A
+reference evaluator then samples a subset of frames. It binary searches every channel and
+interpolates with a lerp and glm::slerp, as skeleton.cpp does. It reports the time and the largest
+difference from the reference.
+
+*/
+
+struct Options {
+	int bones;
+	float fps;
+	float seconds;
+	float keysPerSecond;
+	unsigned int threads;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+static float randomFloat(float lo, float hi) {
+	return lo + (hi - lo) * (std::rand() / float(RAND_MAX));
+}
+
+// Key times with random gaps averaging 1 / keysPerSecond, always covering [0, length].
+static std::vector<double> irregularTimes(double length, double ticksPerKey) {
+	std::vector<double> times(1, 0.0);
+	while (times.back() < length) {
+		times.push_back(std::min(length, times.back() + ticksPerKey * randomFloat(0.2f, 1.8f)));
+	}
+	return times;
+}
+
+Mesh animatedSkeleton(const Options& options, double ticksPerSecond) {
+	Mesh mesh;
+	mesh.name = "skeleton";
+	double length = options.seconds * ticksPerSecond;
+	double ticksPerKey = ticksPerSecond / options.keysPerSecond;
+
+	AnimationInfo info;
+	info.length = (float)length;
+	info.fps = (float)ticksPerSecond;
+	mesh.animations["clip"] = info;
+
+	for (int b = 0; b < options.bones; ++b) {
+		MeshBone bone;
+		bone.index = b;
+		bone.pindex = b - 1;
+		AnimationKeys& keys = bone.animations["clip"];
+
+		std::vector<double> times = irregularTimes(length, ticksPerKey);
+		for (size_t k = 0; k < times.size(); ++k) {
+			aiVectorKey key;
+			key.mTime = times[k];
+			key.mValue = aiVector3D(randomFloat(-1.0f, 1.0f), randomFloat(-1.0f, 1.0f), randomFloat(-1.0f, 1.0f));
+			keys.positionKeys.push_back(key);
+		}
+		times = irregularTimes(length, ticksPerKey);
+		for (size_t k = 0; k < times.size(); ++k) {
+			glm::quat q = glm::normalize(glm::quat(randomFloat(-1.0f, 1.0f), randomFloat(-1.0f, 1.0f), randomFloat(-1.0f, 1.0f), randomFloat(-1.0f, 1.0f)));
+			aiQuatKey key;
+			key.mTime = times[k];
+			key.mValue.x = q.x; key.mValue.y = q.y; key.mValue.z = q.z; key.mValue.w = q.w;
+			keys.rotationKeys.push_back(key);
+		}
+		// Sparse scale keys, as in most exported clips.
+		times = irregularTimes(length, ticksPerKey * 8.0);
+		for (size_t k = 0; k < times.size(); ++k) {
+			aiVectorKey key;
+			key.mTime = times[k];
+			float s = randomFloat(0.5f, 1.5f);
+			key.mValue = aiVector3D(s, s, s);
+			keys.scaleKeys.push_back(key);
+		}
+
+		char name[32];
+		std::sprintf(name, "bone%d", b);
+		mesh.bones[name] = bone;
+	}
+	return mesh;
+}
+
+struct KeyTimeLess {
+	template <typename Key>
+	bool operator()(double time, const Key& key) const { return time < key.mTime; }
+};
+
+// Bracketing keys of time, or the same key twice outside the track.
+template <typename Key>
+static void bracket(const std::vector<Key>& keys, double time, const Key*& a, const Key*& b, float& t) {
+	typename std::vector<Key>::const_iterator next = std::upper_bound(keys.begin(), keys.end(), time, KeyTimeLess());
+	if (next == keys.begin() || next == keys.end()) {
+		a = b = next == keys.begin() ? &keys.front() : &keys.back();
+		t = 0.0f;
+		return;
+	}
+	a = &*(next - 1);
+	b = &*next;
+	t = float((time - a->mTime) / (b->mTime - a->mTime));
+}
+
+static glm::quat toGlm(const aiQuaternion& q) {
+	return glm::quat(q.w, q.x, q.y, q.z);
+}
+
+// Largest position and rotation differences (rotation as an angle in degrees).
+static void compare(const Mesh& mesh, const ResampledClip& clip, double ticksPerSecond, int frameStep,
+	float& positionError, float& rotationError) {
+
+	positionError = rotationError = 0.0f;
+	std::vector<const MeshBone*> bones;
+	std::string error;
+	bonesByIndex(mesh, bones, error);
+	double length = mesh.animations.begin()->second.length;
+
+	for (unsigned int frame = 0; frame < clip.frameCount; frame += frameStep) {
+		double time = std::min(frame * ticksPerSecond / clip.sampleRate, length);
+		for (size_t b = 0; b < bones.size(); ++b) {
+			const AnimationKeys& keys = bones[b]->animations.find("clip")->second;
+			const aiVectorKey* pa; const aiVectorKey* pb; float t;
+			bracket(keys.positionKeys, time, pa, pb, t);
+			aiVector3D p = pa->mValue + (pb->mValue - pa->mValue) * t;
+			const float* sampled = &clip.positions[(frame * clip.boneCount + b) * 3];
+			for (unsigned int c = 0; c < 3; ++c) {
+				positionError = std::max(positionError, std::fabs(sampled[c] - p[c]));
+			}
+
+			const aiQuatKey* ra; const aiQuatKey* rb;
+			bracket(keys.rotationKeys, time, ra, rb, t);
+			glm::quat r = glm::normalize(glm::slerp(toGlm(ra->mValue), toGlm(rb->mValue), t));
+			const float* q = &clip.rotations[(frame * clip.boneCount + b) * 4];
+			// Angle from the chord length; acos loses precision near 1. q and -q are the same rotation.
+			float sign = r.x * q[0] + r.y * q[1] + r.z * q[2] + r.w * q[3] < 0.0f ? -1.0f : 1.0f;
+			double chord = 0.0;
+			double d[4] = { r.x - sign * q[0], r.y - sign * q[1], r.z - sign * q[2], r.w - sign * q[3] };
+			for (unsigned int c = 0; c < 4; ++c) {
+				chord += d[c] * d[c];
+			}
+			float angle = float(4.0 * std::asin(std::min(std::sqrt(chord) * 0.5, 1.0)) * 57.2957795);
+			rotationError = std::max(rotationError, angle);
+		}
+	}
+}
+
+int main(int argc, char* argv[]) {
+	Options options = { 150, 60.0f, 300.0f, 30.0f, 0 };
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--bones" && i + 1 < argc) {
+			options.bones = std::atoi(argv[++i]);
+		} else if (arg == "--fps" && i + 1 < argc) {
+			options.fps = (float)std::atof(argv[++i]);
+		} else if (arg == "--seconds" && i + 1 < argc) {
+			options.seconds = (float)std::atof(argv[++i]);
+		} else if (arg == "--keys-per-second" && i + 1 < argc) {
+			options.keysPerSecond = (float)std::atof(argv[++i]);
+		} else if (arg == "--threads" && i + 1 < argc) {
+			options.threads = std::atoi(argv[++i]);
+		} else {
+			std::cout << "Usage: animation-resample [--bones N] [--fps N] [--seconds N] [--keys-per-second N] [--threads N]\n";
+			return 1;
+		}
+	}
+	if (options.bones < 1 || options.fps <= 0.0f || options.seconds <= 0.0f || options.keysPerSecond <= 0.0f) {
+		std::cout << "--bones, --fps, --seconds and --keys-per-second must be positive.\n";
+		return 1;
+	}
+
+	std::srand(1);
+	const double ticksPerSecond = 24.0;
+	Mesh mesh = animatedSkeleton(options, ticksPerSecond);
+	std::cout << "Skeleton: " << options.bones << " bones, " << options.seconds << " s, about "
+		<< options.keysPerSecond << " keys per second per channel.";
+
+	ResampleOptions resampleOptions;
+	resampleOptions.sampleRate = options.fps;
+	resampleOptions.threadCount = options.threads;
+
+	Clock::time_point begin = Clock::now();
+	std::vector<ResampledClip> clips = resampleAnimations(mesh, resampleOptions);
+	double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+	const ResampledClip& clip = clips[0];
+
+	float positionError, rotationError;
+	compare(mesh, clip, ticksPerSecond, 7, positionError, rotationError);
+
+	double samples = double(clip.frameCount) * clip.boneCount;
+	std::cout << "\n\nResampled " << clip.frameCount << " frames x " << clip.boneCount << " bones in "
+		<< seconds * 1000.0 << " ms (" << samples / seconds / 1e6 << " M bone samples/s).";
+	std::cout << "\nLargest difference from the reference: position " << positionError
+		<< ", rotation " << rotationError << " degrees.";
+	std::cout << "\n";
+
+	bool ok = positionError < 1e-4f && rotationError < 0.005f;
+	if (!ok) {
+		std::cout << "FAILED: resampled values differ from the reference.\n";
+	}
+	return ok ? 0 : 1;
+}
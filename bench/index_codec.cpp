@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/indexcodec.h"
+
+/*
+
+Size, speed and round-trip harness for the index stream codec (src/indexcodec.cpp).
+
+Builds a regular grid and encodes its triangle list in three vertex orders:
+	- rows:       vertices numbered row by row, triangles emitted row by row
+	- first use:  the same triangles, vertices renumbered in the order the triangles first
+	              reference them, as a vertex fetch optimizer leaves them
+	- shuffled:   triangles in random order, the worst case for the edge FIFO
+For each it reports bytes per triangle and decode throughput (GB/s of 32-bit indices
+written), and exits with 1 if any decoded list differs from the original.
+
+*/
+
+struct Options {
+	int grid;
+	int iterations;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+std::vector<unsigned int> gridTriangles(int grid) {
+	std::vector<unsigned int> index;
+	index.reserve(size_t(grid - 1) * (grid - 1) * 6);
+	for (int y = 0; y + 1 < grid; ++y) {
+		for (int x = 0; x + 1 < grid; ++x) {
+			unsigned int a = y * grid + x, b = a + 1, c = a + grid, d = c + 1;
+			index.push_back(a); index.push_back(c); index.push_back(b);
+			index.push_back(b); index.push_back(c); index.push_back(d);
+		}
+	}
+	return index;
+}
+
+std::vector<unsigned int> firstUseOrder(const std::vector<unsigned int>& index) {
+	std::vector<unsigned int> remap;
+	std::vector<unsigned int> out(index.size());
+	unsigned int next = 0;
+	for (size_t i = 0; i < index.size(); ++i) {
+		if (index[i] >= remap.size()) {
+			remap.resize(index[i] + 1, ~0u);
+		}
+		if (remap[index[i]] == ~0u) {
+			remap[index[i]] = next++;
+		}
+		out[i] = remap[index[i]];
+	}
+	return out;
+}
+
+std::vector<unsigned int> shuffledTriangles(const std::vector<unsigned int>& index) {
+	std::srand(1);
+	std::vector<unsigned int> order(index.size() / 3);
+	for (size_t i = 0; i < order.size(); ++i) {
+		order[i] = i;
+	}
+	for (size_t i = order.size(); i > 1; --i) {
+		std::swap(order[i - 1], order[std::rand() % i]);
+	}
+	std::vector<unsigned int> out;
+	out.reserve(index.size());
+	for (size_t i = 0; i < order.size(); ++i) {
+		out.insert(out.end(), &index[order[i] * 3], &index[order[i] * 3] + 3);
+	}
+	return out;
+}
+
+// Returns false if the decoded list differs from the original.
+bool measure(const char* name, const std::vector<unsigned int>& index, int iterations) {
+	Clock::time_point begin = Clock::now();
+	std::vector<unsigned char> stream = encodeIndexStream(index);
+	double encodeTime = std::chrono::duration<double>(Clock::now() - begin).count();
+
+	std::vector<unsigned int> decoded(index.size());
+	bool decodedOk = true;
+	begin = Clock::now();
+	for (int i = 0; i < iterations; ++i) {
+		decodedOk = decodeIndexStream(&stream[0], stream.size(), &decoded[0], decoded.size()) && decodedOk;
+	}
+	double decodeTime = std::chrono::duration<double>(Clock::now() - begin).count();
+
+	bool equal = decodedOk && decoded == index;
+	double triangles = double(index.size() / 3);
+	double bytes = double(index.size() * sizeof(unsigned int)) * iterations;
+	std::cout << "\n" << name << ": " << stream.size() << " bytes, " << stream.size() / triangles << " bytes per triangle"
+		<< "\n    encode: " << encodeTime * 1000.0 << " ms"
+		<< "\n    decode: " << (decodeTime > 0 ? bytes / decodeTime / 1e9 : 0) << " GB/s"
+		<< "\n    round trip: " << (equal ? "identical" : "DIFFERENT");
+	return equal;
+}
+
+int main(int argc, char* argv[]) {
+	Options options = { 1024, 20 };
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--grid" && hasValue) {
+			options.grid = std::atoi(argv[++i]);
+		} else if (arg == "--iterations" && hasValue) {
+			options.iterations = std::atoi(argv[++i]);
+		} else {
+			std::cout << "Usage: index-codec [--grid N] [--iterations N]\n";
+			return 1;
+		}
+	}
+	if (options.grid < 2 || options.iterations < 1) {
+		std::cout << "--grid must be at least 2 and --iterations positive.\n";
+		return 1;
+	}
+
+	std::vector<unsigned int> rows = gridTriangles(options.grid);
+	std::cout << "Grid: " << options.grid << " x " << options.grid << " vertices, " << rows.size() / 3 << " triangles.";
+
+	bool ok = true;
+	ok = measure("rows", rows, options.iterations) && ok;
+	ok = measure("first use", firstUseOrder(rows), options.iterations) && ok;
+	ok = measure("shuffled", shuffledTriangles(rows), options.iterations) && ok;
+
+	std::cout << "\n\n" << (ok ? "All round trips identical." : "Round trip mismatch.") << "\n";
+	return ok ? 0 : 1;
+}
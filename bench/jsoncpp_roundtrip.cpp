@@ -0,0 +1,352 @@
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <json/json.h>
+
+/*
+
+Throughput and round-trip harness for our copy of jsoncpp (src/jsoncpp.cpp).
+
+Generates a document shaped like the converter's output (large numeric arrays plus many
+small keyframe objects), then for each writer: serializes it, parses the text back with
+Json::Reader, and checks the result against the original with Value::compare. Reports MB/s
+for both directions and exits with 1 if any round trip differs, so it can gate every
+jsoncpp performance change. ParallelStyledWriter must also write exactly StyledWriter's
+bytes: the generated model and a set of small edge-case documents are written with both
+(at several thread counts) and compared. It first checks that copies of shared values and the hashes
+ValueInternTable caches stay consistent when elements are written through held references.
+
+Notes:
+	- Integers are generated as Json::Int: the Reader parses every integer that fits as an
+	  intValue, and compare() is type-strict.
+	- By default reals are multiples of 1/1024 and key times are whole ticks, which the
+	  writers' "%.16g" formatting reproduces exactly. --full-precision uses arbitrary float
+	  values instead; those do not all survive "%.16g", which this harness will report.
+
+*/
+
+struct Options {
+	int vertices;
+	int bones;
+	int keys;
+	int iterations;
+	bool fullPrecision;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+double randomReal(bool fullPrecision) {
+	double r = (std::rand() / double(RAND_MAX) - 0.5) * 200.0;
+	if (fullPrecision) {
+		return float(r);
+	}
+	return std::floor(r * 1024.0) / 1024.0;
+}
+
+Json::Value randomArray(int count, bool fullPrecision) {
+	Json::Value array(Json::arrayValue);
+	for (int i = 0; i < count; ++i) {
+		array.append(randomReal(fullPrecision));
+	}
+	return array;
+}
+
+Json::Value generateModel(const Options& options) {
+	std::srand(1);
+	Json::Value root;
+
+	root.emplace("vertices", randomArray(options.vertices * 3, options.fullPrecision));
+	root.emplace("normals", randomArray(options.vertices * 3, options.fullPrecision));
+	root["uvs"].append(randomArray(options.vertices * 2, options.fullPrecision));
+
+	Json::Value faces(Json::arrayValue);
+	for (int i = 0; i < options.vertices; ++i) {
+		faces.append(10);
+		faces.append(std::rand() % options.vertices);
+		faces.append(std::rand() % options.vertices);
+		faces.append(std::rand() % options.vertices);
+		faces.append(0);
+		faces.append(i * 3);
+		faces.append(i * 3 + 1);
+		faces.append(i * 3 + 2);
+	}
+	root.emplace("faces", std::move(faces));
+
+	Json::Value skinIndices(Json::arrayValue);
+	Json::Value skinWeights(Json::arrayValue);
+	for (int i = 0; i < options.vertices; ++i) {
+		skinIndices.append(std::rand() % (options.bones ? options.bones : 1));
+		skinIndices.append(0);
+		skinWeights.append(std::floor(std::rand() / double(RAND_MAX) * 1024.0) / 1024.0);
+		skinWeights.append(0);
+	}
+	root.emplace("skinIndices", std::move(skinIndices));
+	root.emplace("skinWeights", std::move(skinWeights));
+
+	Json::Value bones(Json::arrayValue);
+	Json::Value animation;
+	animation["name"] = "Take \"001\"";
+	animation["length"] = double(options.keys);
+	animation["fps"] = 24;
+	Json::Value& hierarchy = animation.emplace("hierarchy", Json::Value(Json::arrayValue));
+	for (int b = 0; b < options.bones; ++b) {
+		Json::Value bone;
+		bone["name"] = "bone_" + std::to_string(b);
+		bone["parent"] = b - 1;
+		bone.emplace("pos", randomArray(3, options.fullPrecision));
+		bone.emplace("rotq", randomArray(4, options.fullPrecision));
+		bone.emplace("scl", randomArray(3, options.fullPrecision));
+		bones.append(std::move(bone));
+
+		Json::Value hierarchyBone;
+		hierarchyBone["parent"] = b - 1;
+		Json::Value& keys = hierarchyBone.emplace("keys", Json::Value(Json::arrayValue));
+		for (int k = 0; k < options.keys; ++k) {
+			Json::Value key;
+			key["time"] = double(k);
+			key.emplace("rot", randomArray(4, options.fullPrecision));
+			key.emplace("pos", randomArray(3, options.fullPrecision));
+			key.emplace("scl", randomArray(3, options.fullPrecision));
+			keys.append(std::move(key));
+		}
+		hierarchy.append(std::move(hierarchyBone));
+	}
+	root.emplace("bones", std::move(bones));
+	root.emplace("animation", std::move(animation));
+
+	Json::Value metadata;
+	metadata["formatVersion"] = 3.1;
+	metadata["generatedBy"] = "jsoncpp-roundtrip";
+	metadata["vertices"] = options.vertices;
+	root.emplace("metadata", std::move(metadata));
+	return root;
+}
+
+double seconds(Clock::time_point begin, Clock::time_point end) {
+	return std::chrono::duration<double>(end - begin).count();
+}
+
+double megabytesPerSecond(std::size_t bytes, int iterations, double elapsed) {
+	return elapsed > 0 ? bytes * double(iterations) / (1024.0 * 1024.0) / elapsed : 0;
+}
+
+// Returns the path of the first node where a and b differ, or an empty string.
+std::string firstDifference(const Json::Value& a, const Json::Value& b, const std::string& path) {
+	if (a.type() != b.type() || a.size() != b.size()) {
+		return path.empty() ? "." : path;
+	}
+	if (a.isArray()) {
+		for (Json::ArrayIndex i = 0; i < a.size(); ++i) {
+			std::string difference = firstDifference(a[i], b[i], path + "[" + std::to_string(i) + "]");
+			if (!difference.empty()) {
+				return difference;
+			}
+		}
+		return "";
+	}
+	if (a.isObject()) {
+		Json::Value::Members members = a.getMemberNames();
+		for (Json::Value::Members::const_iterator it = members.begin(); it != members.end(); ++it) {
+			std::string difference = firstDifference(a[*it], b[*it], path + "." + *it);
+			if (!difference.empty()) {
+				return difference;
+			}
+		}
+		return "";
+	}
+	return a == b ? "" : (path.empty() ? "." : path);
+}
+
+// Returns false if the parsed document differs from the original.
+bool roundTrip(const char* name, Json::Writer& writer, const Json::Value& model, int iterations) {
+	std::string document;
+	Clock::time_point begin = Clock::now();
+	for (int i = 0; i < iterations; ++i) {
+		document = writer.write(model);
+	}
+	double writeTime = seconds(begin, Clock::now());
+
+	Json::Value parsed;
+	bool parsedOk = true;
+	Json::Reader reader;
+	begin = Clock::now();
+	for (int i = 0; i < iterations; ++i) {
+		parsedOk = reader.parse(document, parsed, false) && parsedOk;
+	}
+	double readTime = seconds(begin, Clock::now());
+
+	bool equal = parsedOk && parsed.compare(model) == 0;
+	std::cout << "\n" << name << ": " << document.size() << " bytes"
+		<< "\n    write: " << megabytesPerSecond(document.size(), iterations, writeTime) << " MB/s"
+		<< "\n    parse: " << megabytesPerSecond(document.size(), iterations, readTime) << " MB/s"
+		<< "\n    round trip: " << (equal ? "identical" : "DIFFERENT");
+	if (!parsedOk) {
+		std::cout << "\n    " << reader.getFormattedErrorMessages();
+	} else if (!equal) {
+		std::string path = firstDifference(model, parsed, "");
+		std::cout << "\n    first difference at " << path << ": wrote "
+			<< Json::Path(path).resolve(model).toStyledString() << "    read back "
+			<< Json::Path(path).resolve(parsed).toStyledString();
+	}
+	return equal;
+}
+
+static bool check(bool condition, const char* what) {
+	if (!condition) {
+		std::cout << "\n    FAILED: " << what;
+	}
+	return condition;
+}
+
+// Returns false if a copy of a shared value sees writes made through an earlier reference,
+// or if interning merges values that a held reference has since made different.
+bool copyOnWriteChecks() {
+	bool ok = true;
+	Json::Value v;
+	v["a"]["b"] = 1;
+	v.share();
+	Json::Value& a = v["a"];
+	Json::Value c = v;
+	a["b"] = 2;
+	ok = check(c["a"]["b"].asInt() == 1, "a copy sees a write through a reference taken before it") && ok;
+	ok = check(v["a"]["b"].asInt() == 2, "a write through a held reference is lost") && ok;
+
+	Json::Value w;
+	w["x"] = Json::Value(Json::arrayValue);
+	w["x"].append(1);
+	w.share();
+	Json::Value::iterator it = w.begin();
+	Json::Value copy = w;
+	(*it)[0u] = 5;
+	ok = check(copy["x"][0u].asInt() == 1, "a copy sees a write through an iterator taken before it") && ok;
+
+	Json::ValueInternTable table;
+	Json::Value first, second;
+	first["key"]["value"] = 1;
+	second["key"]["value"] = 1;
+	table.intern(first);
+	table.intern(second);
+	ok = check(first.hash() == second.hash(), "equal values hash differently") && ok;
+	Json::Value& held = second["key"];
+	std::size_t before = second.hash();
+	held["value"] = 2;
+	Json::Value third;
+	third["key"]["value"] = 2;
+	ok = check(first != second, "a write through a held reference reaches an interned copy") && ok;
+	ok = check(second.hash() != before && second.hash() == third.hash(),
+		"a hash is stale after a write through a held reference") && ok;
+	table.intern(second);
+	table.intern(third);
+	ok = check(third == second && second["key"]["value"].asInt() == 2 && first["key"]["value"].asInt() == 1,
+		"interning after a write merges the wrong values") && ok;
+
+	std::cout << "\nCopy-on-write: " << (ok ? "copies and hashes consistent" : "INCONSISTENT");
+	return ok;
+}
+
+// Small documents covering the shapes ParallelStyledWriter handles separately: non-object
+// roots, empty and scalar members, single-line arrays and comments.
+std::vector<Json::Value> edgeCaseDocuments() {
+	std::vector<Json::Value> documents;
+	documents.push_back(Json::Value());
+	documents.push_back(Json::Value(Json::objectValue));
+	documents.push_back(randomArray(40, true));
+
+	Json::Value members;
+	members["empty array"] = Json::Value(Json::arrayValue);
+	members["empty object"] = Json::Value(Json::objectValue);
+	members["number"] = 1.5;
+	members["string"] = "line\nbreak \"quoted\"";
+	members["short"] = randomArray(3, false);
+	members["long"] = randomArray(200, true);
+	members["nested"]["deeper"]["array"].append(Json::Value(Json::objectValue));
+	members["nested"]["deeper"]["array"].append(Json::Value(Json::arrayValue));
+	members["nested"]["deeper"]["array"].append(2);
+	members["nested"].setComment("// before nested", Json::commentBefore);
+	members["long"].setComment("// after long", Json::commentAfterOnSameLine);
+	documents.push_back(members);
+
+	Json::Value single;
+	single["only"] = randomArray(1000, false);
+	documents.push_back(single);
+	return documents;
+}
+
+// Returns false if ParallelStyledWriter's output differs from StyledWriter's for any document.
+bool sameAsStyledWriter(const std::vector<const Json::Value*>& documents) {
+	static const unsigned int threadCounts[] = { 0, 1, 2, 7 };
+	Json::StyledWriter styledWriter;
+	bool ok = true;
+	for (size_t d = 0; d < documents.size(); ++d) {
+		std::string expected = styledWriter.write(*documents[d]);
+		for (unsigned int t = 0; t < sizeof(threadCounts) / sizeof(threadCounts[0]); ++t) {
+			Json::ParallelStyledWriter parallelWriter(threadCounts[t]);
+			std::string written = parallelWriter.write(*documents[d]);
+			if (written != expected) {
+				size_t at = 0;
+				while (at < written.size() && at < expected.size() && written[at] == expected[at]) ++at;
+				std::cout << "\n    FAILED: document " << d << " with " << threadCounts[t]
+					<< " thread(s) differs from StyledWriter at byte " << at << " of " << expected.size();
+				ok = false;
+			}
+		}
+	}
+	std::cout << "\nParallelStyledWriter: " << (ok ? "identical to StyledWriter" : "DIFFERENT from StyledWriter")
+		<< " on " << documents.size() << " documents";
+	return ok;
+}
+
+int main(int argc, char* argv[]) {
+	Options options = { 100000, 50, 100, 3, false };
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--vertices" && hasValue) {
+			options.vertices = std::atoi(argv[++i]);
+		} else if (arg == "--bones" && hasValue) {
+			options.bones = std::atoi(argv[++i]);
+		} else if (arg == "--keys" && hasValue) {
+			options.keys = std::atoi(argv[++i]);
+		} else if (arg == "--iterations" && hasValue) {
+			options.iterations = std::atoi(argv[++i]);
+		} else if (arg == "--full-precision") {
+			options.fullPrecision = true;
+		} else {
+			std::cout << "Usage: jsoncpp-roundtrip [--vertices N] [--bones N] [--keys N] [--iterations N] [--full-precision]\n";
+			return 1;
+		}
+	}
+	if (options.vertices < 1 || options.iterations < 1) {
+		std::cout << "--vertices and --iterations must be positive.\n";
+		return 1;
+	}
+
+	std::cout << "Generating model: " << options.vertices << " vertices, " << options.bones << " bones, "
+		<< options.keys << " keys per bone.";
+	Json::Value model = generateModel(options);
+
+	Json::FastWriter fastWriter;
+	Json::StyledWriter styledWriter;
+	Json::ParallelStyledWriter parallelWriter;
+
+	bool ok = copyOnWriteChecks();
+
+	std::vector<Json::Value> edgeCases = edgeCaseDocuments();
+	std::vector<const Json::Value*> documents(1, &model);
+	for (size_t i = 0; i < edgeCases.size(); ++i) {
+		documents.push_back(&edgeCases[i]);
+	}
+	ok = sameAsStyledWriter(documents) && ok;
+	ok = roundTrip("FastWriter", fastWriter, model, options.iterations) && ok;
+	ok = roundTrip("StyledWriter", styledWriter, model, options.iterations) && ok;
+	ok = roundTrip("ParallelStyledWriter", parallelWriter, model, options.iterations) && ok;
+
+	std::cout << "\n\n" << (ok ? "All round trips identical." : "Round trip mismatch.") << "\n";
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,257 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/vertexlayout.h"
+
+/*
+
+Upload and draw cost harness for the vertex layout stage (src/vertexlayout.cpp).
+
+There is no GPU here, so both costs are modelled on the CPU:
+	- upload: copying every buffer into a fresh allocation, as bufferData does, plus the
+	  number of bindBuffer/vertexAttribPointer calls the layout needs per draw
+	- draw:   fetching and decoding every attribute of every vertex through the index
+	          buffer, as the vertex stage does, in cache order and with the triangles
+	          shuffled
+Layouts compared: separate float32 buffers, interleaved float32, and interleaved with
+compact formats (snorm8 normal and tangent, float16 uv).
+
+Every layout is also decoded back and compared with the mesh's attributes, within half a
+step of each component format. The harness exits with 1 if any value is off.
+
+*/
+
+struct Options {
+	int grid;
+	int iterations;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+Mesh gridMesh(int grid) {
+	Mesh mesh;
+	mesh.name = "grid";
+	for (int y = 0; y < grid; ++y) {
+		for (int x = 0; x < grid; ++x) {
+			float u = x / float(grid - 1), v = y / float(grid - 1);
+			mesh.vertex.push_back(aiVector3D(u, std::sin(u * 6.0f) * 0.1f, v));
+			mesh.normal.push_back(aiVector3D(0.0f, 1.0f, 0.0f));
+			mesh.tangent.push_back(aiVector3D(1.0f, 0.0f, 0.0f));
+			mesh.tangentSign.push_back(1.0f);
+			mesh.uv.push_back(aiVector3D(u, v, 0.0f));
+		}
+	}
+	for (int y = 0; y + 1 < grid; ++y) {
+		for (int x = 0; x + 1 < grid; ++x) {
+			unsigned int a = y * grid + x, b = a + 1, c = a + grid, d = c + 1;
+			mesh.index.push_back(a); mesh.index.push_back(c); mesh.index.push_back(b);
+			mesh.index.push_back(b); mesh.index.push_back(c); mesh.index.push_back(d);
+		}
+	}
+	mesh.numFaces = mesh.index.size() / 3;
+	return mesh;
+}
+
+std::vector<unsigned int> shuffledTriangles(const std::vector<unsigned int>& index) {
+	std::srand(1);
+	std::vector<unsigned int> order(index.size() / 3);
+	for (size_t i = 0; i < order.size(); ++i) {
+		order[i] = i;
+	}
+	for (size_t i = order.size(); i > 1; --i) {
+		std::swap(order[i - 1], order[std::rand() % i]);
+	}
+	std::vector<unsigned int> out;
+	out.reserve(index.size());
+	for (size_t i = 0; i < order.size(); ++i) {
+		out.insert(out.end(), &index[order[i] * 3], &index[order[i] * 3] + 3);
+	}
+	return out;
+}
+
+float halfToFloat(unsigned short half) {
+	unsigned int exponent = (half >> 10) & 0x1f, mantissa = half & 0x3ff;
+	float value = exponent == 0 ? std::ldexp(float(mantissa), -24) : std::ldexp(float(mantissa | 0x400), int(exponent) - 25);
+	return half & 0x8000 ? -value : value;
+}
+
+float readComponent(const unsigned char* p, ComponentFormat format) {
+	switch (format) {
+	case ComponentFloat32: { float v; std::memcpy(&v, p, 4); return v; }
+	case ComponentFloat16: { unsigned short v; std::memcpy(&v, p, 2); return halfToFloat(v); }
+	case ComponentSnorm16: { short v; std::memcpy(&v, p, 2); return std::max(v / 32767.0f, -1.0f); }
+	case ComponentUnorm16: { unsigned short v; std::memcpy(&v, p, 2); return v / 65535.0f; }
+	case ComponentUint16: { unsigned short v; std::memcpy(&v, p, 2); return v; }
+	case ComponentSnorm8: return std::max((signed char)*p / 127.0f, -1.0f);
+	case ComponentUnorm8: return *p / 255.0f;
+	case ComponentUint8: return *p;
+	}
+	return 0.0f;
+}
+
+// Sum of every fetched component, so the fetches cannot be optimized away.
+double fetchVertices(const VertexLayout& layout, const std::vector<unsigned int>& index) {
+	double sum = 0.0;
+	for (size_t i = 0; i < index.size(); ++i) {
+		for (size_t a = 0; a < layout.attributes.size(); ++a) {
+			const VertexLayoutAttribute& attribute = layout.attributes[a];
+			unsigned int size = componentSize(attribute.format);
+			const unsigned char* p = &layout.buffers[attribute.buffer][size_t(index[i]) * layout.strides[attribute.buffer] + attribute.offset];
+			for (unsigned int c = 0; c < attribute.components; ++c) {
+				sum += readComponent(p + c * size, attribute.format);
+			}
+		}
+	}
+	return sum;
+}
+
+// Largest error a component format may add to a value: half a quantization step.
+float tolerance(ComponentFormat format, float value) {
+	switch (format) {
+	case ComponentFloat32: return 0.0f;
+	case ComponentFloat16: return std::fabs(value) / 2048.0f + 1.0f / (1 << 24);
+	case ComponentSnorm16: return 0.5f / 32767.0f + 1e-6f;
+	case ComponentUnorm16: return 0.5f / 65535.0f + 1e-6f;
+	case ComponentSnorm8: return 0.5f / 127.0f + 1e-6f;
+	case ComponentUnorm8: return 0.5f / 255.0f + 1e-6f;
+	case ComponentUint16:
+	case ComponentUint8: return 0.5f;
+	}
+	return 0.0f;
+}
+
+// Decodes every vertex of the layout; returns false if an attribute is missing or a value
+// differs from the mesh by more than its format allows.
+bool decodesToMesh(const VertexLayout& layout, const Mesh& mesh) {
+	for (size_t a = 0; a < layout.attributes.size(); ++a) {
+		const VertexLayoutAttribute& attribute = layout.attributes[a];
+		std::vector<float> source;
+		if (attribute.name == "position") {
+			source = flatten(mesh.vertex, mesh.vertex.size(), 3);
+		} else if (attribute.name == "normal") {
+			source = flatten(mesh.normal, mesh.vertex.size(), 3);
+		} else if (attribute.name == "tangent") {
+			source = tangentsWithSign(mesh);
+		} else if (attribute.name == "uv") {
+			source = flatten(mesh.uv, mesh.vertex.size(), 2);
+		}
+		if (source.size() != size_t(layout.count) * attribute.components) {
+			std::cout << "\n    " << attribute.name << ": not in the mesh";
+			return false;
+		}
+
+		unsigned int size = componentSize(attribute.format);
+		for (size_t v = 0; v < layout.count; ++v) {
+			const unsigned char* p = &layout.buffers[attribute.buffer][v * layout.strides[attribute.buffer] + attribute.offset];
+			for (unsigned int c = 0; c < attribute.components; ++c) {
+				float expected = source[v * attribute.components + c];
+				float decoded = readComponent(p + c * size, attribute.format);
+				if (!(std::fabs(decoded - expected) <= tolerance(attribute.format, expected))) {
+					std::cout << "\n    " << attribute.name << " of vertex " << v << ": wrote " << expected << ", read back " << decoded;
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+double seconds(Clock::time_point begin) {
+	return std::chrono::duration<double>(Clock::now() - begin).count();
+}
+
+// Returns false if the layout does not decode back to the mesh's attributes.
+bool measure(const char* name, const Mesh& mesh, const VertexLayoutOptions& layoutOptions,
+	const std::vector<unsigned int>& shuffled, int iterations) {
+
+	VertexLayout layout = buildVertexLayout(mesh, layoutOptions);
+	size_t bytes = 0;
+	for (size_t b = 0; b < layout.buffers.size(); ++b) {
+		bytes += layout.buffers[b].size();
+	}
+
+	Clock::time_point begin = Clock::now();
+	size_t checksum = 0;
+	for (int i = 0; i < iterations; ++i) {
+		for (size_t b = 0; b < layout.buffers.size(); ++b) {
+			std::vector<unsigned char> gpu(layout.buffers[b].size());
+			std::memcpy(&gpu[0], &layout.buffers[b][0], gpu.size());
+			checksum += gpu[gpu.size() / 2];
+		}
+	}
+	double uploadTime = seconds(begin) / iterations;
+
+	begin = Clock::now();
+	double sum = 0.0;
+	for (int i = 0; i < iterations; ++i) {
+		sum += fetchVertices(layout, mesh.index);
+	}
+	double orderedTime = seconds(begin) / iterations;
+
+	begin = Clock::now();
+	for (int i = 0; i < iterations; ++i) {
+		sum += fetchVertices(layout, shuffled);
+	}
+	double shuffledTime = seconds(begin) / iterations;
+
+	double fetches = double(mesh.index.size());
+	std::cout << "\n" << name << ": " << layout.buffers.size() << " buffer(s), stride";
+	for (size_t b = 0; b < layout.strides.size(); ++b) {
+		std::cout << (b ? "/" : " ") << layout.strides[b];
+	}
+	std::cout << ", " << bytes << " bytes"
+		<< "\n    upload: " << uploadTime * 1000.0 << " ms, "
+		<< layout.buffers.size() << " bindBuffer + " << layout.attributes.size() << " vertexAttribPointer calls"
+		<< "\n    draw (cache order): " << orderedTime / fetches * 1e9 << " ns per vertex"
+		<< "\n    draw (shuffled): " << shuffledTime / fetches * 1e9 << " ns per vertex"
+		<< "\n    (checksum " << checksum + size_t(sum) % 7 << ")";
+
+	bool decoded = decodesToMesh(layout, mesh);
+	std::cout << "\n    decoded: " << (decoded ? "matches the mesh" : "DIFFERENT");
+	return decoded;
+}
+
+int main(int argc, char* argv[]) {
+	Options options = { 1024, 5 };
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--grid" && hasValue) {
+			options.grid = std::atoi(argv[++i]);
+		} else if (arg == "--iterations" && hasValue) {
+			options.iterations = std::atoi(argv[++i]);
+		} else {
+			std::cout << "Usage: vertex-layout [--grid N] [--iterations N]\n";
+			return 1;
+		}
+	}
+	if (options.grid < 2 || options.iterations < 1) {
+		std::cout << "--grid must be at least 2 and --iterations positive.\n";
+		return 1;
+	}
+
+	Mesh mesh = gridMesh(options.grid);
+	std::vector<unsigned int> shuffled = shuffledTriangles(mesh.index);
+	std::cout << "Grid: " << mesh.vertex.size() << " vertices, " << mesh.index.size() / 3 << " triangles.";
+
+	VertexLayoutOptions separate;
+	separate.interleaved = false;
+	bool ok = measure("separate float32", mesh, separate, shuffled, options.iterations);
+
+	VertexLayoutOptions interleaved;
+	ok = measure("interleaved float32", mesh, interleaved, shuffled, options.iterations) && ok;
+
+	VertexLayoutOptions compact;
+	std::string error;
+	parseVertexFormats("position:float32,normal:snorm8,tangent:snorm8,uv:float16", compact.attributes, error);
+	ok = measure("interleaved compact", mesh, compact, shuffled, options.iterations) && ok;
+
+	std::cout << "\n\n" << (ok ? "All layouts decode to the mesh." : "Layout mismatch.") << "\n";
+	return ok ? 0 : 1;
+}
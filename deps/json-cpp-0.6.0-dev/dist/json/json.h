@@ -156,6 +156,41 @@ license you like.
 # define JSONCPP_DEPRECATED(message)
 #endif // if !defined(JSONCPP_DEPRECATED)
 
+// If JSON_HAS_RVALUE_REFERENCES is non-zero, Value provides a move constructor,
+// move assignment, append( Value && ) and emplace(). Subtrees built on the side
+// can then be handed to their parent without a deep copy.
+#if !defined(JSON_HAS_RVALUE_REFERENCES)
+# if defined(_MSC_VER)  &&  _MSC_VER >= 1600 // MSVC 2010
+#  define JSON_HAS_RVALUE_REFERENCES 1
+# elif __cplusplus >= 201103L  ||  defined(__GXX_EXPERIMENTAL_CXX0X__)
+#  define JSON_HAS_RVALUE_REFERENCES 1
+# else
+#  define JSON_HAS_RVALUE_REFERENCES 0
+# endif
+#endif // if !defined(JSON_HAS_RVALUE_REFERENCES)
+
+// The move operations are marked JSON_NOEXCEPT so std::vector<Value> moves its elements
+// when it grows instead of copying them.
+#if !defined(JSON_NOEXCEPT)
+# if (defined(_MSC_VER)  &&  _MSC_VER >= 1900)  ||  (!defined(_MSC_VER)  &&  __cplusplus >= 201103L)
+#  define JSON_NOEXCEPT noexcept
+# else
+#  define JSON_NOEXCEPT throw()
+# endif
+#endif // if !defined(JSON_NOEXCEPT)
+
+// If JSON_HAS_STD_THREAD is non-zero, ParallelStyledWriter formats large
+// subtrees on several threads. Otherwise it falls back to StyledWriter.
+#if !defined(JSON_HAS_STD_THREAD)
+# if defined(_MSC_VER)  &&  _MSC_VER >= 1700 // MSVC 2012
+#  define JSON_HAS_STD_THREAD 1
+# elif __cplusplus >= 201103L  ||  defined(__GXX_EXPERIMENTAL_CXX0X__)
+#  define JSON_HAS_STD_THREAD 1
+# else
+#  define JSON_HAS_STD_THREAD 0
+# endif
+#endif // if !defined(JSON_HAS_STD_THREAD)
+
 namespace Json {
    typedef int Int;
    typedef unsigned int UInt;
@@ -223,6 +258,8 @@ namespace Json {
    class StaticString;
    class Path;
    class PathArgument;
+   class CompiledPath;
+   class ValueInternTable;
    class Value;
    class ValueIteratorBase;
    class ValueIterator;
@@ -435,6 +472,7 @@ namespace Json {
    class JSON_API Value 
    {
       friend class ValueIteratorBase;
+      friend class ValueInternTable;
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
       friend class ValueInternalLink;
       friend class ValueInternalMap;
@@ -492,6 +530,9 @@ namespace Json {
          CZString( ArrayIndex index );
          CZString( const char *cstr, DuplicationPolicy allocate );
          CZString( const CZString &other );
+#  if JSON_HAS_RVALUE_REFERENCES
+         CZString( CZString &&other );
+#  endif
          ~CZString();
          CZString &operator =( const CZString &other );
          bool operator<( const CZString &other ) const;
@@ -557,9 +598,18 @@ namespace Json {
 # endif
       Value( bool value );
       Value( const Value &other );
+#if JSON_HAS_RVALUE_REFERENCES
+      /// Steal the content of other, leaving it null.
+      Value( Value &&other ) JSON_NOEXCEPT;
+#endif
       ~Value();
 
       Value &operator=( const Value &other );
+#if JSON_HAS_RVALUE_REFERENCES
+      /// Take over the content of other, leaving it null.
+      /// \note Like copy assignment, comments are not transferred.
+      Value &operator=( Value &&other ) JSON_NOEXCEPT;
+#endif
       /// Swap values.
       /// \note Currently, comments are intentionally not swapped, for
       /// both logic and efficiency.
@@ -665,6 +715,12 @@ namespace Json {
       ///
       /// Equivalent to jsonvalue[jsonvalue.size()] = value;
       Value &append( const Value &value );
+#if JSON_HAS_RVALUE_REFERENCES
+      /// \brief Move value to the end of the array.
+      ///
+      /// The appended subtree is not copied; value is left null.
+      Value &append( Value &&value );
+#endif
 
       /// Access an object value by name, create a null member if it does not exist.
       Value &operator[]( const char *key );
@@ -692,6 +748,25 @@ namespace Json {
       /// Access an object value by name, returns null if there is no member with that name.
       const Value &operator[]( const CppTL::ConstString &key ) const;
 # endif
+#if JSON_HAS_RVALUE_REFERENCES
+      /** \brief Move value into the member named key, creating it if it does not exist.
+
+       * The subtree is stored directly in the object without an intermediate null
+       * member or a copy; value is left null.
+       * \return the stored member.
+       * \pre type() is objectValue or nullValue
+       * \post type() is objectValue
+       * Example of use:
+       * \code
+       * Json::Value vertices( Json::arrayValue );
+       * // ... fill vertices ...
+       * root.emplace( "vertices", std::move( vertices ) );
+       * \endcode
+       */
+      Value &emplace( const char *key, Value &&value );
+      /// Same as emplace( const char *, Value && ).
+      Value &emplace( const std::string &key, Value &&value );
+#endif
       /// Return the member named key if it exist, defaultValue otherwise.
       Value get( const char *key, 
                  const Value &defaultValue ) const;
@@ -746,6 +821,25 @@ namespace Json {
 
       std::string toStyledString() const;
 
+      /** \brief Make this value and every array or object below it copy-on-write.
+
+       * Copying a shared array or object only increments a reference count;
+       * the elements are cloned the first time either copy is accessed through
+       * a non-const member. Values that are never shared copy deeply as before.
+       * Once a non-const reference or iterator to an element has been handed
+       * out, copies clone the elements again, so writes through it never reach
+       * a copy; calling share() declares that no such reference is still used.
+       * \note Reference counts are not atomic: shared subtrees must not be
+       *       copied concurrently from several threads.
+       * \note Has no effect when JSON_VALUE_USE_INTERNAL_MAP is defined.
+       */
+      void share();
+      /// Return true if this array or object is stored copy-on-write.
+      bool isShared() const;
+      /// Hash of the content of the value, consistent with operator==.
+      /// Reuses the hashes cached by ValueInternTable; never writes to the value.
+      std::size_t hash() const;
+
       const_iterator begin() const;
       const_iterator end() const;
 
@@ -755,6 +849,10 @@ namespace Json {
    private:
       Value &resolveReference( const char *key, 
                                bool isStatic );
+      void detach();
+      void leak();
+      void makeShared();
+      void releaseMap();
 
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
       inline bool isItemAvailable() const
@@ -814,6 +912,7 @@ namespace Json {
       } value_;
       ValueType type_ : 8;
       int allocated_ : 1;     // Notes: if declared as bool, bitfield is useless.
+      unsigned int shared_ : 1;          // map_ is reference counted, see share().
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
       unsigned int itemIsUsed_ : 1;      // used by the ValueInternalMap container.
       int memberNameIsStatic_ : 1;       // used by the ValueInternalMap container.
@@ -828,6 +927,7 @@ namespace Json {
    {
    public:
       friend class Path;
+      friend class CompiledPath;
 
       PathArgument();
       PathArgument( ArrayIndex index );
@@ -889,6 +989,123 @@ namespace Json {
       Args args_;
    };
 
+   /** \brief A query parsed once and resolved against any number of documents.
+    *
+    * Path reparses its string every time one is constructed. A CompiledPath
+    * keeps the parsed steps, so resolving it only costs the tree walk, and it
+    * can select several nodes.
+    *
+    * Syntax is the one of Path, plus:
+    * - ".*" => every member of an object value
+    * - "[*]" => every element of an array value
+    * - "[b:e]" => elements b (inclusive) to e (exclusive) of an array value;
+    *   either bound may be omitted.
+    *
+    * Example:
+    * \code
+    * Json::CompiledPath keys( ".animation.hierarchy[*].keys" );
+    * Json::CompiledPath::Nodes nodes;
+    * for ( ... each model ... )
+    *    keys.resolve( model, nodes );
+    * \endcode
+    */
+   class JSON_API CompiledPath
+   {
+   public:
+      typedef std::vector<const Value *> Nodes;
+      typedef std::vector<const Value *> Documents;
+
+      CompiledPath();
+      CompiledPath( const std::string &path,
+                    const PathArgument &a1 = PathArgument(),
+                    const PathArgument &a2 = PathArgument(),
+                    const PathArgument &a3 = PathArgument(),
+                    const PathArgument &a4 = PathArgument(),
+                    const PathArgument &a5 = PathArgument() );
+
+      /// Return false if the path could not be parsed; such a path matches nothing.
+      bool isValid() const;
+
+      /// Append every node of root matched by the path to nodes, in document order.
+      void resolve( const Value &root, Nodes &nodes ) const;
+      /// Return the first node matched by the path, or Value::null.
+      const Value &resolveFirst( const Value &root ) const;
+      /// Resolve the path against each document; results[i] receives the
+      /// matches of documents[i].
+      void resolveAll( const Documents &documents,
+                       std::vector<Nodes> &results ) const;
+
+   private:
+      struct Step
+      {
+         enum Kind
+         {
+            member = 0,
+            index,
+            anyMember,
+            slice
+         };
+         Kind kind_;
+         std::string key_;
+         ArrayIndex begin_;
+         ArrayIndex end_;
+      };
+      typedef std::vector<Step> Steps;
+
+      void compile( const std::string &path,
+                    const std::vector<const PathArgument *> &in );
+      /// Append the matches below node to nodes. With firstOnly, stop at the
+      /// first match and return true.
+      bool resolveStep( const Value &node,
+                        Steps::size_type step,
+                        Nodes &nodes,
+                        bool firstOnly ) const;
+
+      Steps steps_;
+      bool valid_;
+   };
+
+   /** \brief Merges structurally equal arrays and objects into shared subtrees.
+    *
+    * intern() walks a tree bottom-up, makes every array and object shared (see
+    * Value::share()) and replaces each one that is equal to a subtree seen
+    * before by a reference to it. Repeated subtrees, like identical keyframes
+    * or default scale arrays, are then stored once. Equal subtrees are found
+    * through Value::hash(), which intern() caches; since children are merged first,
+    * comparing candidates mostly reduces to comparing pointers.
+    *
+    * The table keeps a reference on every subtree it has seen; clear() it to
+    * release them. Like share(), intern() expects that no reference or
+    * iterator into root obtained before the call is used afterwards.
+    */
+   class JSON_API ValueInternTable
+   {
+   public:
+      void intern( Value &root );
+      /// Number of distinct arrays and objects in the table.
+      std::size_t size() const;
+      void clear();
+
+   private:
+      typedef std::multimap<std::size_t, Value> Entries;
+      Entries entries_;
+   };
+
+   /** \brief Compiles each distinct path string once.
+    *
+    * Tools that receive their queries as strings can look them up here instead
+    * of constructing a Path per query. Only paths without '%' arguments can be
+    * cached. Not thread safe.
+    */
+   class JSON_API PathCache
+   {
+   public:
+      const CompiledPath &get( const std::string &path );
+
+   private:
+      std::map<std::string, CompiledPath> paths_;
+   };
+
 
 
 #ifdef JSON_VALUE_USE_INTERNAL_MAP
@@ -1736,6 +1953,8 @@ namespace Json {
     *     - if empty then print [] without indent and line break
     *     - if the array contains no object value, empty array or some other value types,
     *       and all the values fit on one lines, then print the array on a single line.
+    *     - if the array only contains numbers without comments and they do not fit on
+    *       one line, then print as many numbers per line as fit in the right margin.
     *     - otherwise, it the values do not fit on one line, or the array contains
     *       object or non empty array, then print one value per line.
     *
@@ -1745,6 +1964,7 @@ namespace Json {
     */
    class JSON_API StyledWriter: public Writer
    {
+      friend class ParallelStyledWriter;
    public:
       StyledWriter();
       virtual ~StyledWriter(){}
@@ -1759,6 +1979,8 @@ namespace Json {
    private:
       void writeValue( const Value &value );
       void writeArrayValue( const Value &value );
+      bool isNumericArray( const Value &value );
+      void writeNumericArrayValue( const Value &value );
       bool isMultineArray( const Value &value );
       void pushValue( const std::string &value );
       void writeIndent();
@@ -1769,6 +1991,8 @@ namespace Json {
       void writeCommentAfterValueOnSameLine( const Value &root );
       bool hasCommentForValue( const Value &value );
       static std::string normalizeEOL( const std::string &text );
+      const std::string &writeMemberValue( const Value &value, 
+                                           const std::string &indentString );
 
       typedef std::vector<std::string> ChildValues;
 
@@ -1780,6 +2004,30 @@ namespace Json {
       bool addChildValues_;
    };
 
+   /** \brief Writes a Value exactly like StyledWriter, formatting the members of
+    * the root object on several threads.
+    *
+    * Each member of a root #objectValue that is a non empty array or object is
+    * formatted concurrently into its own buffer. The buffers are then stitched
+    * in member order, so the output is byte-identical to StyledWriter::write().
+    * Any other root value is written by a plain StyledWriter.
+    *
+    * \sa StyledWriter
+    */
+   class JSON_API ParallelStyledWriter: public Writer
+   {
+   public:
+      /// \param threadCount Number of formatting threads. 0 uses one per hardware thread.
+      ParallelStyledWriter( unsigned int threadCount = 0 );
+      virtual ~ParallelStyledWriter(){}
+
+   public: // overridden from Writer
+      virtual std::string write( const Value &root );
+
+   private:
+      unsigned int threadCount_;
+   };
+
    /** \brief Writes a Value in <a HREF="http://www.json.org">JSON</a> format in a human friendly way,
         to a stream rather than to a string.
     *
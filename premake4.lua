@@ -34,8 +34,40 @@ solution "assimp-to-json"
 	links   { "assimp" }
 	targetdir "./bin/Release"
 
+    configuration "gmake"
+        buildoptions { "-std=c++11", "-pthread", "-mssse3" }
+        linkoptions  { "-pthread" }
+
     project "assimp-to-json"
         kind "ConsoleApp"
 	language "C++"
 	files { "./src/**.cpp", "./src/**.h" }
 	location "./proj"
+
+    -- Throughput and round-trip gate for src/jsoncpp.cpp, see bench/jsoncpp_roundtrip.cpp.
+    project "jsoncpp-roundtrip"
+        kind "ConsoleApp"
+	language "C++"
+	files { "./bench/jsoncpp_roundtrip.cpp", "./src/jsoncpp.cpp" }
+	location "./proj"
+
+    -- Size, decode speed and round-trip gate for src/indexcodec.cpp, see bench/index_codec.cpp.
+    project "index-codec"
+        kind "ConsoleApp"
+	language "C++"
+	files { "./bench/index_codec.cpp", "./src/indexcodec.cpp" }
+	location "./proj"
+
+    -- Upload and vertex fetch cost of the layouts from src/vertexlayout.cpp, see bench/vertex_layout.cpp.
+    project "vertex-layout"
+        kind "ConsoleApp"
+	language "C++"
+	files { "./bench/vertex_layout.cpp", "./src/vertexlayout.cpp", "./src/mesh.cpp", "./src/base64.cpp", "./src/jsoncpp.cpp", "./src/allocationcounter.cpp" }
+	location "./proj"
+
+    -- Speed and accuracy gate for src/resample.cpp, see bench/animation_resample.cpp.
+    project "animation-resample"
+        kind "ConsoleApp"
+	language "C++"
+	files { "./bench/animation_resample.cpp", "./src/resample.cpp", "./src/mesh.cpp", "./src/base64.cpp", "./src/jsoncpp.cpp", "./src/allocationcounter.cpp" }
+	location "./proj"
@@ -0,0 +1,70 @@
+#include "allocationcounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+	std::atomic<unsigned long long> allocationCount(0);
+	std::atomic<unsigned long long> allocationBytes(0);
+}
+
+unsigned long long AllocationCounter::allocations() {
+	return allocationCount.load(std::memory_order_relaxed);
+}
+
+unsigned long long AllocationCounter::bytes() {
+	return allocationBytes.load(std::memory_order_relaxed);
+}
+
+#ifdef DEBUG
+
+namespace {
+	void* countedAlloc(std::size_t size) {
+		allocationCount.fetch_add(1, std::memory_order_relaxed);
+		allocationBytes.fetch_add(size, std::memory_order_relaxed);
+		return std::malloc(size ? size : 1);
+	}
+}
+
+void* operator new(std::size_t size) {
+	void* p = countedAlloc(size);
+	if (!p) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void* operator new[](std::size_t size) {
+	void* p = countedAlloc(size);
+	if (!p) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) throw() {
+	return countedAlloc(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) throw() {
+	return countedAlloc(size);
+}
+
+void operator delete(void* p) throw() {
+	std::free(p);
+}
+
+void operator delete[](void* p) throw() {
+	std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) throw() {
+	std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) throw() {
+	std::free(p);
+}
+
+#endif
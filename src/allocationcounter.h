@@ -0,0 +1,48 @@
+#ifndef ASSIMP_TO_JSON_ALLOCATION_COUNTER_H
+#define ASSIMP_TO_JSON_ALLOCATION_COUNTER_H
+
+#include <iostream>
+
+/*
+
+Debug builds replace the global operator new/delete (see allocationcounter.cpp) so each
+converter stage can report how many heap allocations it made. This is how we catch
+hidden deep copies of the mesh IR or the JSON tree creeping back into the pipeline.
+
+Only allocations made through operator new are counted; jsoncpp's string buffers are
+malloc'd directly and do not show up.
+
+*/
+
+namespace AllocationCounter {
+	unsigned long long allocations();
+	unsigned long long bytes();
+}
+
+// Prints the number of allocations made between construction and destruction.
+class StageAllocations {
+public:
+#ifdef DEBUG
+	explicit StageAllocations(const char* stage)
+		: stage(stage), allocations(AllocationCounter::allocations()), bytes(AllocationCounter::bytes()) {}
+
+	~StageAllocations() {
+		std::cout << "\n[alloc] " << stage << ": "
+			<< AllocationCounter::allocations() - allocations << " allocations, "
+			<< AllocationCounter::bytes() - bytes << " bytes.";
+	}
+
+private:
+	const char* stage;
+	unsigned long long allocations;
+	unsigned long long bytes;
+#else
+	explicit StageAllocations(const char*) {}
+#endif
+
+private:
+	StageAllocations(const StageAllocations&);
+	StageAllocations& operator=(const StageAllocations&);
+};
+
+#endif
@@ -0,0 +1,163 @@
+#include <iostream>
+#include <algorithm>
+#include <utility>
+#include <cmath>
+#include <cfloat>
+
+#include "animationbounds.h"
+#include "skeleton.h"
+#include "allocationcounter.h"
+
+static BoundingVolume boundPoints(const glm::simdVec4* points, size_t count) {
+	BoundingVolume volume;
+	if (count == 0) {
+		std::fill(volume.min, volume.min + 3, 0.0f);
+		std::fill(volume.max, volume.max + 3, 0.0f);
+		std::fill(volume.center, volume.center + 3, 0.0f);
+		volume.radius = 0.0f;
+		return volume;
+	}
+
+	glm::simdVec4 lo = points[0], hi = points[0];
+	for (size_t i = 1; i < count; ++i) {
+		lo = glm::min(lo, points[i]);
+		hi = glm::max(hi, points[i]);
+	}
+	glm::simdVec4 center = (lo + hi) * 0.5f;
+
+	float radiusSquared = 0.0f;
+	for (size_t i = 0; i < count; ++i) {
+		glm::simdVec4 d = points[i] - center;
+		radiusSquared = std::max(radiusSquared, glm::dot(d, d));
+	}
+
+	glm::vec4 l = glm::vec4_cast(lo), h = glm::vec4_cast(hi), c = glm::vec4_cast(center);
+	volume.min[0] = l.x; volume.min[1] = l.y; volume.min[2] = l.z;
+	volume.max[0] = h.x; volume.max[1] = h.y; volume.max[2] = h.z;
+	volume.center[0] = c.x; volume.center[1] = c.y; volume.center[2] = c.z;
+	volume.radius = std::sqrt(radiusSquared);
+	return volume;
+}
+
+// Smallest volume (AABB union, sphere centered on it) containing every frame's volume.
+static BoundingVolume mergeVolumes(const std::vector<BoundingVolume>& frames) {
+	BoundingVolume volume = frames[0];
+	for (size_t f = 1; f < frames.size(); ++f) {
+		for (unsigned int c = 0; c < 3; ++c) {
+			volume.min[c] = std::min(volume.min[c], frames[f].min[c]);
+			volume.max[c] = std::max(volume.max[c], frames[f].max[c]);
+		}
+	}
+	volume.radius = 0.0f;
+	for (unsigned int c = 0; c < 3; ++c) {
+		volume.center[c] = (volume.min[c] + volume.max[c]) * 0.5f;
+	}
+	for (size_t f = 0; f < frames.size(); ++f) {
+		float dx = frames[f].center[0] - volume.center[0];
+		float dy = frames[f].center[1] - volume.center[1];
+		float dz = frames[f].center[2] - volume.center[2];
+		volume.radius = std::max(volume.radius, std::sqrt(dx * dx + dy * dy + dz * dz) + frames[f].radius);
+	}
+	return volume;
+}
+
+std::vector<ClipBounds> computeAnimationBounds(const Mesh& mesh, const AnimationBoundsOptions& options) {
+	StageAllocations stageAllocations("computeAnimationBounds");
+	std::cout << "\n\nComputing animation bounds.";
+
+	std::vector<ClipBounds> clips;
+	if (mesh.bones.empty() || mesh.vertex.empty()) {
+		return clips;
+	}
+
+	std::vector<const MeshBone*> bones;
+	std::string error;
+	if (!bonesByIndex(mesh, bones, error)) {
+		std::cout << "\nSkipped: " << error << ".";
+		return clips;
+	}
+
+	std::vector<unsigned short> boneIndices;
+	std::vector<float> boneWeights;
+	collectSkinInfluences(mesh, influencesPerVertex, boneIndices, boneWeights);
+
+	std::vector<glm::simdVec4> skinned(mesh.vertex.size());
+	std::vector<glm::simdMat4> skinMatrices;
+
+	for (AnimationInfoConstIterator it = mesh.animations.begin(); it != mesh.animations.end(); ++it) {
+		std::vector<double> times = animationKeyTimes(mesh, it->first);
+		if (times.empty()) {
+			times.push_back(0.0);
+		}
+
+		std::vector<BoundingVolume> frames;
+		frames.reserve(times.size());
+		for (size_t f = 0; f < times.size(); ++f) {
+			evaluateSkinMatrices(bones, it->first, times[f], skinMatrices);
+			skinVertices(mesh, skinMatrices, boneIndices, boneWeights, influencesPerVertex, 0, mesh.vertex.size(), &skinned[0]);
+			frames.push_back(boundPoints(&skinned[0], skinned.size()));
+		}
+
+		ClipBounds clip;
+		clip.name = it->first;
+		clip.clip = mergeVolumes(frames);
+		if (options.perFrame) {
+			clip.times = std::move(times);
+			clip.frames = std::move(frames);
+		}
+		std::cout << "\n    " << clip.name << ": radius " << clip.clip.radius;
+		clips.push_back(std::move(clip));
+	}
+
+	return clips;
+}
+
+static Json::Value volumeToJson(const BoundingVolume& volume) {
+	Json::Value json;
+	Json::Value& min = json.emplace("min", Json::Value(Json::arrayValue));
+	Json::Value& max = json.emplace("max", Json::Value(Json::arrayValue));
+	Json::Value& center = json.emplace("center", Json::Value(Json::arrayValue));
+	for (unsigned int c = 0; c < 3; ++c) {
+		min.append(volume.min[c]);
+		max.append(volume.max[c]);
+		center.append(volume.center[c]);
+	}
+	json["radius"] = volume.radius;
+	return json;
+}
+
+Json::Value animationBoundsToJson(const Mesh& mesh, const std::vector<ClipBounds>& clips) {
+	Json::Value root;
+
+	std::vector<glm::simdVec4> bindPose(mesh.vertex.size());
+	for (size_t v = 0; v < mesh.vertex.size(); ++v) {
+		bindPose[v] = glm::simdVec4(mesh.vertex[v].x, mesh.vertex[v].y, mesh.vertex[v].z, 1.0f);
+	}
+	root.emplace("bindPose", volumeToJson(boundPoints(bindPose.empty() ? NULL : &bindPose[0], bindPose.size())));
+
+	Json::Value& clipsJson = root.emplace("clips", Json::Value(Json::objectValue));
+	for (size_t i = 0; i < clips.size(); ++i) {
+		const ClipBounds& clip = clips[i];
+		Json::Value json = volumeToJson(clip.clip);
+
+		if (!clip.frames.empty()) {
+			// Flat arrays: times, then min/max (6) and center/radius (4) per frame.
+			Json::Value& frames = json.emplace("frames", Json::Value(Json::objectValue));
+			Json::Value& times = frames.emplace("times", Json::Value(Json::arrayValue));
+			Json::Value& boxes = frames.emplace("boxes", Json::Value(Json::arrayValue));
+			Json::Value& spheres = frames.emplace("spheres", Json::Value(Json::arrayValue));
+			for (size_t f = 0; f < clip.frames.size(); ++f) {
+				const BoundingVolume& volume = clip.frames[f];
+				times.append(clip.times[f]);
+				for (unsigned int c = 0; c < 3; ++c) boxes.append(volume.min[c]);
+				for (unsigned int c = 0; c < 3; ++c) boxes.append(volume.max[c]);
+				for (unsigned int c = 0; c < 3; ++c) spheres.append(volume.center[c]);
+				spheres.append(volume.radius);
+			}
+		}
+
+		clipsJson.emplace(clip.name, std::move(json));
+	}
+
+	return root;
+}
@@ -0,0 +1,49 @@
+#ifndef ASSIMP_TO_JSON_ANIMATION_BOUNDS_H
+#define ASSIMP_TO_JSON_ANIMATION_BOUNDS_H
+
+#include <string>
+#include <vector>
+
+#include <json\json.h>
+
+#include "mesh.h"
+
+/*
+
+Bounds of the skinned mesh over each animation, so the runtime can cull animated
+characters with a volume that holds for the whole clip (or for each frame) instead of
+the bind-pose box.
+
+Every clip is evaluated at each of its key times (see skeleton.h), the vertices are
+skinned, and the AABB and the bounding sphere (centered on the AABB) are taken. The clip
+volume contains every frame's volume.
+
+*/
+
+struct AnimationBoundsOptions {
+	AnimationBoundsOptions() : perFrame(false) {}
+
+	bool perFrame;
+};
+
+struct BoundingVolume {
+	float min[3];
+	float max[3];
+	float center[3];
+	float radius;
+};
+
+struct ClipBounds {
+	std::string name;
+	BoundingVolume clip;
+	// Filled when perFrame is set; times are in animation ticks.
+	std::vector<double> times;
+	std::vector<BoundingVolume> frames;
+};
+
+std::vector<ClipBounds> computeAnimationBounds(const Mesh& mesh, const AnimationBoundsOptions& options);
+
+// {"bindPose": volume, "clips": {name: volume (+ "frames")}}, for the output metadata.
+Json::Value animationBoundsToJson(const Mesh& mesh, const std::vector<ClipBounds>& clips);
+
+#endif
@@ -0,0 +1,149 @@
+#include <iostream>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <utility>
+#include <cstdio>
+
+#include "animationfiles.h"
+#include "allocationcounter.h"
+
+// Document members holding per-clip entries, and the member each entry takes in its clip file.
+struct ClipMember {
+	const char* documentMember;
+	const char* clipMember;
+};
+
+static const ClipMember clipMembers[] = {
+	{ "animation", "animation" },
+	{ "animations", "animation" },
+	{ "bakedAnimations", "bakedAnimation" },
+	{ "resampledAnimations", "resampledAnimation" }
+};
+static const unsigned int clipMemberCount = sizeof(clipMembers) / sizeof(clipMembers[0]);
+
+static unsigned long long fnv1a(const std::string& bytes) {
+	unsigned long long hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < bytes.size(); ++i) {
+		hash ^= (unsigned char)bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+static std::string toHex(unsigned long long value) {
+	char digits[17];
+	std::sprintf(digits, "%016llx", value);
+	return digits;
+}
+
+static std::string fileNamePart(const std::string& name) {
+	std::string part = name.empty() ? "clip" : name;
+	for (size_t i = 0; i < part.size(); ++i) {
+		char c = part[i];
+		bool allowed = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-' || c == '.';
+		if (!allowed) {
+			part[i] = '_';
+		}
+	}
+	return part;
+}
+
+static bool writeFile(const std::string& path, const std::string& bytes) {
+	// Binary, so the bytes on disk are the ones that were measured and hashed.
+	std::ofstream file(path.c_str(), std::ios::binary);
+	if (!file) {
+		std::cout << "\nCould not open " << path;
+		return false;
+	}
+	file.write(bytes.data(), bytes.size());
+	file.close();
+	if (!file) {
+		std::cout << "\nCould not write " << path;
+		return false;
+	}
+	return true;
+}
+
+bool writeAnimationFiles(const Mesh& mesh, Json::Value& document, const std::string& outputFilename) {
+	StageAllocations stageAllocations("writeAnimationFiles");
+	std::cout << "\n\nWriting animation clips to separate files.";
+
+	std::map<std::string, Json::Value> clips;
+	for (unsigned int m = 0; m < clipMemberCount; ++m) {
+		if (!document.isMember(clipMembers[m].documentMember)) {
+			continue;
+		}
+		Json::Value entries = document.removeMember(clipMembers[m].documentMember);
+		if (entries.isObject()) {
+			Json::Value single = Json::Value(Json::arrayValue);
+			single.append(std::move(entries));
+			entries = std::move(single);
+		}
+		if (!entries.isArray()) {
+			continue;
+		}
+		for (Json::ArrayIndex i = 0; i < entries.size(); ++i) {
+			std::string name = entries[i]["name"].asString();
+			Json::Value& clip = clips[name];
+			clip["name"] = name;
+			clip.emplace(clipMembers[m].clipMember, std::move(entries[i]));
+		}
+	}
+
+	size_t extension = outputFilename.find_last_of('.');
+	size_t directory = outputFilename.find_last_of("/\\");
+	std::string stem = (extension != std::string::npos && (directory == std::string::npos || extension > directory))
+		? outputFilename.substr(0, extension) : outputFilename;
+	std::string prefix = directory == std::string::npos ? std::string() : outputFilename.substr(0, directory + 1);
+	std::string stemName = directory == std::string::npos ? stem : stem.substr(directory + 1);
+
+	Json::StyledWriter writer;
+	Json::Value index;
+	Json::Value& entries = index.emplace("clips", Json::Value(Json::arrayValue));
+	std::set<std::string> usedNames;
+	size_t totalBytes = 0;
+
+	for (std::map<std::string, Json::Value>::iterator it = clips.begin(); it != clips.end(); ++it) {
+		std::string part = fileNamePart(it->first);
+		std::string fileName = stemName + "." + part + ".json";
+		for (unsigned int suffix = 2; usedNames.count(fileName) || fileName == stemName + ".animations.json"; ++suffix) {
+			std::ostringstream numbered;
+			numbered << stemName << "." << part << "-" << suffix << ".json";
+			fileName = numbered.str();
+		}
+		usedNames.insert(fileName);
+
+		std::string bytes = writer.write(it->second);
+		if (!writeFile(prefix + fileName, bytes)) {
+			return false;
+		}
+
+		Json::Value entry;
+		entry["name"] = it->first;
+		entry["file"] = fileName;
+		AnimationInfoConstIterator info = mesh.animations.find(it->first);
+		if (info != mesh.animations.end()) {
+			double ticksPerSecond = info->second.fps > 0.0f ? info->second.fps : defaultTicksPerSecond;
+			entry["length"] = info->second.length;
+			entry["fps"] = info->second.fps;
+			entry["duration"] = info->second.length / ticksPerSecond;
+		}
+		entry["byteLength"] = (Json::UInt)bytes.size();
+		entry["hash"] = toHex(fnv1a(bytes));
+		entries.append(std::move(entry));
+
+		std::cout << "\n    " << fileName << ": " << bytes.size() << " bytes";
+		totalBytes += bytes.size();
+	}
+
+	std::string indexName = stemName + ".animations.json";
+	if (!writeFile(prefix + indexName, writer.write(index))) {
+		return false;
+	}
+	document["animationIndex"] = indexName;
+
+	std::cout << "\n" << clips.size() << " clip(s), " << totalBytes << " bytes, indexed in " << indexName << ".";
+	return true;
+}
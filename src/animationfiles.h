@@ -0,0 +1,33 @@
+#ifndef ASSIMP_TO_JSON_ANIMATION_FILES_H
+#define ASSIMP_TO_JSON_ANIMATION_FILES_H
+
+#include <string>
+
+#include <json\json.h>
+
+#include "mesh.h"
+
+/*
+
+Moves every animation clip out of the output document into a file of its own, so a runtime
+can fetch the clips it plays on demand and keep unchanged clips cached.
+
+A clip gathers everything the document holds for it by name: the legacy clip ("animation"
+or "animations"), its baked vertex animation ("bakedAnimations") and its resampled tracks
+("resampledAnimations"). Next to outputFilename, for output "model.js":
+	model.<clip>.json        {"name", "animation", "bakedAnimation", "resampledAnimation"},
+	                         each member present when the document had it
+	model.animations.json    the index, {"clips": [{"name", "file", "length", "fps",
+	                         "duration", "byteLength", "hash"}]}
+length and fps are in ticks, as in the legacy clip, and duration is in seconds. hash is the
+64-bit FNV-1a of the clip file's bytes, as 16 hex digits. Clip names are reduced to
+[A-Za-z0-9_.-] in file names, with a numeric suffix when two collide.
+
+The document's clip members are removed and "animationIndex" names the index file.
+
+*/
+
+// Returns false when a file cannot be written.
+bool writeAnimationFiles(const Mesh& mesh, Json::Value& document, const std::string& outputFilename);
+
+#endif
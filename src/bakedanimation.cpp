@@ -0,0 +1,170 @@
+#include <iostream>
+#include <algorithm>
+#include <utility>
+#include <cmath>
+
+#include "bakedanimation.h"
+#include "buffergeometry.h"
+#include "skeleton.h"
+#include "parallel.h"
+#include "allocationcounter.h"
+
+namespace {
+
+// Everything a worker needs to bake any frame of one clip.
+struct BakeJob {
+	const Mesh* mesh;
+	const std::vector<const MeshBone*>* bones;
+	const std::vector<unsigned short>* boneIndices;
+	const std::vector<float>* boneWeights;
+	const std::string* animationName;
+	double ticksPerFrame;
+	double lengthTicks;
+	bool normals;
+	BakedClip* clip;
+};
+
+}
+
+static void bakeFrame(const BakeJob& job, unsigned int frame,
+	std::vector<glm::simdMat4>& skinMatrices, std::vector<glm::simdVec4>& skinned) {
+
+	const Mesh& mesh = *job.mesh;
+	BakedClip& clip = *job.clip;
+	size_t numVertices = clip.vertexCount;
+
+	evaluateSkinMatrices(*job.bones, *job.animationName, std::min(frame * job.ticksPerFrame, job.lengthTicks), skinMatrices);
+	skinVertices(mesh, skinMatrices, *job.boneIndices, *job.boneWeights, influencesPerVertex, 0, numVertices, &skinned[0]);
+
+	glm::simdVec4 lo = skinned[0], hi = skinned[0];
+	for (size_t v = 1; v < numVertices; ++v) {
+		lo = glm::min(lo, skinned[v]);
+		hi = glm::max(hi, skinned[v]);
+	}
+	glm::vec4 l = glm::vec4_cast(lo), h = glm::vec4_cast(hi);
+	glm::vec4 scale = (h - l) / 65535.0f;
+	glm::simdVec4 inverseScale(
+		scale.x > 0.0f ? 1.0f / scale.x : 0.0f,
+		scale.y > 0.0f ? 1.0f / scale.y : 0.0f,
+		scale.z > 0.0f ? 1.0f / scale.z : 0.0f,
+		0.0f);
+
+	float* range = &clip.ranges[frame * 6];
+	range[0] = l.x; range[1] = l.y; range[2] = l.z;
+	range[3] = scale.x; range[4] = scale.y; range[5] = scale.z;
+
+	unsigned short* positions = &clip.positions[frame * numVertices * 3];
+	for (size_t v = 0; v < numVertices; ++v) {
+		glm::vec4 q = glm::vec4_cast((skinned[v] - lo) * inverseScale + glm::simdVec4(0.5f));
+		positions[v * 3 + 0] = (unsigned short)std::min(q.x, 65535.0f);
+		positions[v * 3 + 1] = (unsigned short)std::min(q.y, 65535.0f);
+		positions[v * 3 + 2] = (unsigned short)std::min(q.z, 65535.0f);
+	}
+
+	if (job.normals) {
+		skinNormals(mesh, skinMatrices, *job.boneIndices, *job.boneWeights, influencesPerVertex, 0, numVertices, &skinned[0]);
+		signed char* normals = &clip.normals[frame * numVertices * 3];
+		for (size_t v = 0; v < numVertices; ++v) {
+			glm::vec4 n = glm::vec4_cast(glm::round(skinned[v] * 127.0f));
+			normals[v * 3 + 0] = (signed char)n.x;
+			normals[v * 3 + 1] = (signed char)n.y;
+			normals[v * 3 + 2] = (signed char)n.z;
+		}
+	}
+}
+
+namespace {
+
+// Bakes a range of frames; frames write to disjoint slices of the clip. Each thread's copy
+// keeps its skin matrices and skinned vertices for the frames it takes.
+struct BakeFrames {
+	const BakeJob* job;
+	std::vector<glm::simdMat4> skinMatrices;
+	std::vector<glm::simdVec4> skinned;
+
+	void operator()(size_t first, size_t last) {
+		skinned.resize(job->clip->vertexCount);
+		for (size_t frame = first; frame < last; ++frame) {
+			bakeFrame(*job, (unsigned int)frame, skinMatrices, skinned);
+		}
+	}
+};
+
+}
+
+std::vector<BakedClip> bakeAnimations(const Mesh& mesh, const BakedAnimationOptions& options) {
+	StageAllocations stageAllocations("bakeAnimations");
+	std::cout << "\n\nBaking animations.";
+
+	std::vector<BakedClip> clips;
+	if (mesh.bones.empty() || mesh.vertex.empty() || options.sampleRate <= 0.0f) {
+		return clips;
+	}
+
+	std::vector<const MeshBone*> bones;
+	std::string error;
+	if (!bonesByIndex(mesh, bones, error)) {
+		std::cout << "\nSkipped: " << error << ".";
+		return clips;
+	}
+
+	std::vector<unsigned short> boneIndices;
+	std::vector<float> boneWeights;
+	collectSkinInfluences(mesh, influencesPerVertex, boneIndices, boneWeights);
+
+	for (AnimationInfoConstIterator it = mesh.animations.begin(); it != mesh.animations.end(); ++it) {
+		const AnimationInfo& info = it->second;
+		double ticksPerSecond = info.fps > 0.0f ? info.fps : defaultTicksPerSecond;
+		double seconds = info.length / ticksPerSecond;
+
+		BakedClip clip;
+		clip.name = it->first;
+		clip.sampleRate = options.sampleRate;
+		clip.frameCount = (unsigned int)std::floor(seconds * options.sampleRate + 1e-6) + 1;
+		clip.vertexCount = mesh.vertex.size();
+		clip.ranges.resize(clip.frameCount * 6);
+		clip.positions.resize(size_t(clip.frameCount) * clip.vertexCount * 3);
+		if (options.normals) {
+			clip.normals.resize(size_t(clip.frameCount) * clip.vertexCount * 3);
+		}
+
+		BakeJob job;
+		job.mesh = &mesh;
+		job.bones = &bones;
+		job.boneIndices = &boneIndices;
+		job.boneWeights = &boneWeights;
+		job.animationName = &clip.name;
+		job.ticksPerFrame = ticksPerSecond / options.sampleRate;
+		job.lengthTicks = info.length;
+		job.normals = options.normals;
+		job.clip = &clip;
+
+		BakeFrames frames;
+		frames.job = &job;
+		parallelFor(clip.frameCount, 1, options.threadCount, frames);
+
+		std::cout << "\n    " << clip.name << ": " << clip.frameCount << " frames";
+		clips.push_back(std::move(clip));
+	}
+
+	return clips;
+}
+
+Json::Value bakedAnimationsToJson(const std::vector<BakedClip>& clips, bool base64) {
+	Json::Value root = Json::Value(Json::arrayValue);
+	for (size_t i = 0; i < clips.size(); ++i) {
+		const BakedClip& clip = clips[i];
+		Json::Value json;
+		json["name"] = clip.name;
+		json["fps"] = clip.sampleRate;
+		json["frames"] = clip.frameCount;
+		json["vertices"] = clip.vertexCount;
+		json.emplace("ranges", typedArrayToJson("Float32Array", 6, clip.ranges, base64));
+		json.emplace("positions", typedArrayToJson("Uint16Array", 3, clip.positions, base64));
+		if (!clip.normals.empty()) {
+			json.emplace("normals", typedArrayToJson("Int8Array", 3, clip.normals, base64));
+		}
+		root.append(std::move(json));
+	}
+	return root;
+}
@@ -0,0 +1,52 @@
+#ifndef ASSIMP_TO_JSON_BAKED_ANIMATION_H
+#define ASSIMP_TO_JSON_BAKED_ANIMATION_H
+
+#include <string>
+#include <vector>
+
+#include <json\json.h>
+
+#include "mesh.h"
+
+/*
+
+Bakes every animation clip into per-frame vertex streams, for clients that cannot afford
+GPU skinning. They play back morph frames instead of bones.
+
+Each clip is sampled at sampleRate frames per second over its length, and all vertices
+are linear-blend skinned on the CPU (see skeleton.h). Frames are spread over threadCount
+worker threads.
+
+Positions are stored per frame as 16-bit unsigned values over that frame's own box:
+	position = min + q * scale
+Each frame's min (3) and scale (3) are in "ranges". Normals, when requested, are 8-bit
+signed values: normal = q / 127.
+
+*/
+
+struct BakedAnimationOptions {
+	BakedAnimationOptions() : sampleRate(30.0f), normals(false), threadCount(0) {}
+
+	float sampleRate;
+	bool normals;
+	// 0 uses std::thread::hardware_concurrency().
+	unsigned int threadCount;
+};
+
+struct BakedClip {
+	std::string name;
+	float sampleRate;
+	unsigned int frameCount;
+	unsigned int vertexCount;
+	// frameCount * 6: min x, y, z, scale x, y, z
+	std::vector<float> ranges;
+	// frameCount * vertexCount * 3
+	std::vector<unsigned short> positions;
+	std::vector<signed char> normals;
+};
+
+std::vector<BakedClip> bakeAnimations(const Mesh& mesh, const BakedAnimationOptions& options);
+
+Json::Value bakedAnimationsToJson(const std::vector<BakedClip>& clips, bool base64);
+
+#endif
@@ -0,0 +1,72 @@
+#include "base64.h"
+
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#define BASE64_USE_SSSE3 1
+#endif
+
+static const char base64Alphabet[] =
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+#ifdef BASE64_USE_SSSE3
+
+// Spreads 12 input bytes over four 32-bit lanes, three bytes per lane, then splits every
+// lane into four 6-bit indices (one per output byte).
+static inline __m128i base64Unpack(__m128i in) {
+	in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+	const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+	const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+	const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+	const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+	return _mm_or_si128(t1, t3);
+}
+
+// Maps 6-bit indices to ASCII by adding a per-range offset picked with pshufb.
+static inline __m128i base64Translate(__m128i indices) {
+	const __m128i shiftTable = _mm_setr_epi8(
+		'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+		'0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+	__m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+	const __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+	range = _mm_or_si128(range, _mm_and_si128(upper, _mm_set1_epi8(13)));
+	return _mm_add_epi8(_mm_shuffle_epi8(shiftTable, range), indices);
+}
+
+#endif
+
+std::string base64Encode(const void* data, size_t size) {
+	const unsigned char* in = static_cast<const unsigned char*>(data);
+	std::string encoded((size + 2) / 3 * 4, '=');
+	char* out = &encoded[0];
+	size_t i = 0;
+
+#ifdef BASE64_USE_SSSE3
+	// Every step reads 16 bytes but consumes 12, so stop while 16 are still readable.
+	for (; i + 16 <= size; i += 12, out += 16) {
+		const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out), base64Translate(base64Unpack(block)));
+	}
+#endif
+
+	for (; i + 3 <= size; i += 3, out += 4) {
+		unsigned int triple = (in[i] << 16) | (in[i + 1] << 8) | in[i + 2];
+		out[0] = base64Alphabet[(triple >> 18) & 0x3f];
+		out[1] = base64Alphabet[(triple >> 12) & 0x3f];
+		out[2] = base64Alphabet[(triple >> 6) & 0x3f];
+		out[3] = base64Alphabet[triple & 0x3f];
+	}
+
+	if (i < size) {
+		unsigned int triple = in[i] << 16;
+		if (i + 1 < size) {
+			triple |= in[i + 1] << 8;
+		}
+		out[0] = base64Alphabet[(triple >> 18) & 0x3f];
+		out[1] = base64Alphabet[(triple >> 12) & 0x3f];
+		if (i + 1 < size) {
+			out[2] = base64Alphabet[(triple >> 6) & 0x3f];
+		}
+	}
+
+	return encoded;
+}
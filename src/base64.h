@@ -0,0 +1,17 @@
+#ifndef ASSIMP_TO_JSON_BASE64_H
+#define ASSIMP_TO_JSON_BASE64_H
+
+#include <string>
+
+/*
+
+Standard (RFC 4648) base64 with '=' padding, used to embed typed arrays in the JSON
+output. Builds with SSSE3 enabled (-mssse3, or __SSSE3__ defined by the compiler) encode
+12 input bytes per step with the pshufb based encoder; everything else, and the tail of
+every buffer, goes through the scalar table encoder. Both produce identical output.
+
+*/
+
+std::string base64Encode(const void* data, size_t size);
+
+#endif
@@ -0,0 +1,93 @@
+#include <iostream>
+#include <utility>
+
+#include "buffergeometry.h"
+#include "indexcodec.h"
+#include "allocationcounter.h"
+
+Json::Value indexArrayToJson(const std::vector<unsigned int>& index, bool base64) {
+	if (fitsInUnsignedShort(index)) {
+		return typedArrayToJson("Uint16Array", 1, narrowIndices(index), base64);
+	}
+	return typedArrayToJson("Uint32Array", 1, index, base64);
+}
+
+static Json::Value compressedIndexToJson(const std::vector<unsigned int>& index) {
+	std::vector<unsigned char> stream = encodeIndexStream(index);
+	std::cout << "\nIndex stream: " << stream.size() << " bytes, "
+		<< (index.size() >= 3 ? float(stream.size()) / (index.size() / 3) : 0.0f) << " bytes per triangle.";
+
+	Json::Value attribute;
+	attribute["itemSize"] = 1;
+	attribute["type"] = fitsInUnsignedShort(index) ? "Uint16Array" : "Uint32Array";
+	attribute["normalized"] = false;
+	attribute["count"] = (Json::UInt)index.size();
+	attribute["encoding"] = "index-codec";
+	attribute["array"] = base64Encode(&stream[0], stream.size());
+	return attribute;
+}
+
+static Json::Value bufferGeometryData(const Mesh& mesh, const BufferGeometryOptions& options) {
+	Json::Value data;
+	Json::Value& attributes = data.emplace("attributes", Json::Value(Json::objectValue));
+
+	attributes.emplace("position", typedArrayToJson("Float32Array", 3, flatten(mesh.vertex, mesh.vertex.size(), 3), options.base64));
+	if (!mesh.normal.empty()) {
+		attributes.emplace("normal", typedArrayToJson("Float32Array", 3, flatten(mesh.normal, mesh.normal.size(), 3), options.base64));
+	}
+	if (!mesh.tangent.empty()) {
+		attributes.emplace("tangent", typedArrayToJson("Float32Array", 4, tangentsWithSign(mesh), options.base64));
+	}
+	if (!mesh.uv.empty()) {
+		attributes.emplace("uv", typedArrayToJson("Float32Array", 2, flatten(mesh.uv, mesh.vertex.size(), 2), options.base64));
+	}
+
+	if (!mesh.bones.empty()) {
+		std::vector<unsigned short> skinIndex;
+		std::vector<float> skinWeight;
+		collectSkinInfluences(mesh, influencesPerVertex, skinIndex, skinWeight);
+		attributes.emplace("skinIndex", typedArrayToJson("Uint16Array", influencesPerVertex, skinIndex, options.base64));
+		attributes.emplace("skinWeight", typedArrayToJson("Float32Array", influencesPerVertex, skinWeight, options.base64));
+	}
+
+	data.emplace("index", options.compressIndices
+		? compressedIndexToJson(mesh.index)
+		: indexArrayToJson(mesh.index, options.base64));
+	return data;
+}
+
+Json::Value meshToBufferGeometry(const Mesh& mesh, const BufferGeometryOptions& options) {
+	StageAllocations stageAllocations("meshToBufferGeometry");
+	Json::Value root;
+	std::cout << "\n\nBuilding BufferGeometry JSON.";
+
+	IndexLayout layout = chooseIndexLayout(mesh, options.indexSplit);
+
+	Json::Value metadata;
+	metadata["version"] = 4.4;
+	metadata["type"] = "BufferGeometry";
+	metadata["generator"] = "assimp-to-json converter";
+	if (!layout.subMeshes.empty()) {
+		metadata["duplicatedVertices"] = (Json::UInt)layout.duplicatedVertices;
+	}
+	root.emplace("metadata", std::move(metadata));
+
+	root["type"] = "BufferGeometry";
+	root["name"] = mesh.name;
+
+	if (layout.subMeshes.empty()) {
+		root.emplace("data", bufferGeometryData(mesh, options));
+	} else {
+		Json::Value& geometries = root.emplace("geometries", Json::Value(Json::arrayValue));
+		for (size_t i = 0; i < layout.subMeshes.size(); ++i) {
+			Json::Value geometry;
+			geometry["type"] = "BufferGeometry";
+			geometry["name"] = mesh.name;
+			geometry.emplace("data", bufferGeometryData(extractSubMesh(mesh, layout.subMeshes[i]), options));
+			geometries.append(std::move(geometry));
+		}
+	}
+
+	std::cout << "\nDone building BufferGeometry JSON.";
+	return root;
+}
@@ -0,0 +1,72 @@
+#ifndef ASSIMP_TO_JSON_BUFFER_GEOMETRY_H
+#define ASSIMP_TO_JSON_BUFFER_GEOMETRY_H
+
+#include <vector>
+
+#include <json\json.h>
+
+#include "mesh.h"
+#include "base64.h"
+#include "indexsplit.h"
+
+/*
+
+Writes the mesh as a three.js BufferGeometry (JSON object format 4) so the loader can hand
+the attribute arrays straight to WebGL instead of expanding the legacy "faces" bitmask into
+a Geometry first.
+
+Attributes: position, normal, tangent (when generated), uv, and skinIndex/skinWeight (four influences per vertex) when
+the mesh has bones. The triangle list is written to data.index.
+
+The index is a Uint16Array up to 65,535 vertices. Past that, chooseIndexLayout() either
+splits the mesh, and "geometries" then holds one BufferGeometry per sub-mesh in place of
+"data", or keeps it whole with a Uint32Array index. Meshlets, LODs and the BVH still refer
+to the unsplit vertex list.
+
+With base64 enabled, each "array" is the base64 encoding of the typed array's raw bytes
+(little endian, as the converter is only built for little-endian targets) and the attribute
+carries "encoding": "base64". The loader decodes it with one atob() and a typed array view
+instead of parsing one number at a time.
+
+With compressIndices enabled, data.index carries "encoding": "index-codec" and "count",
+and "array" is the base64 of encodeIndexStream() (see indexcodec.h).
+
+*/
+
+struct BufferGeometryOptions {
+	BufferGeometryOptions() : base64(false), compressIndices(false) {}
+
+	bool base64;
+	bool compressIndices;
+	IndexSplitOptions indexSplit;
+};
+
+// A BufferAttribute-style typed array: {"itemSize", "type", "normalized", "array"}, with
+// "array" replaced by the base64 of the raw bytes (plus "encoding": "base64") when asked.
+// Other writers use this too, so every typed array in the output has the same shape.
+template <typename T>
+Json::Value typedArrayToJson(const char* type, int itemSize, const std::vector<T>& values, bool base64) {
+	Json::Value attribute;
+	attribute["itemSize"] = itemSize;
+	attribute["type"] = type;
+	attribute["normalized"] = false;
+
+	if (base64) {
+		attribute["encoding"] = "base64";
+		attribute["array"] = values.empty() ? std::string() : base64Encode(&values[0], values.size() * sizeof(T));
+	} else {
+		Json::Value& array = attribute.emplace("array", Json::Value(Json::arrayValue));
+		for (size_t i = 0; i < values.size(); ++i) {
+			array.append(values[i]);
+		}
+	}
+
+	return attribute;
+}
+
+// A Uint16Array when every index fits, a Uint32Array otherwise.
+Json::Value indexArrayToJson(const std::vector<unsigned int>& index, bool base64);
+
+Json::Value meshToBufferGeometry(const Mesh& mesh, const BufferGeometryOptions& options);
+
+#endif
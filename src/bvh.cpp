@@ -0,0 +1,280 @@
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <utility>
+#include <cfloat>
+
+#include "bvh.h"
+#include "buffergeometry.h"
+#include "allocationcounter.h"
+
+namespace {
+
+struct Box {
+	Box() {
+		for (unsigned int c = 0; c < 3; ++c) {
+			min[c] = FLT_MAX;
+			max[c] = -FLT_MAX;
+		}
+	}
+
+	void grow(const float* p) {
+		for (unsigned int c = 0; c < 3; ++c) {
+			min[c] = std::min(min[c], p[c]);
+			max[c] = std::max(max[c], p[c]);
+		}
+	}
+
+	void grow(const Box& box) {
+		for (unsigned int c = 0; c < 3; ++c) {
+			min[c] = std::min(min[c], box.min[c]);
+			max[c] = std::max(max[c], box.max[c]);
+		}
+	}
+
+	float area() const {
+		if (min[0] > max[0]) {
+			return 0.0f;
+		}
+		float dx = max[0] - min[0], dy = max[1] - min[1], dz = max[2] - min[2];
+		return 2.0f * (dx * dy + dy * dz + dz * dx);
+	}
+
+	float min[3];
+	float max[3];
+};
+
+struct BuildContext {
+	const BvhOptions* options;
+	std::vector<Box> triangleBounds;
+	std::vector<float> centroids;
+	// Triangle order; ranges of it are partitioned in place, disjoint ranges on different threads.
+	std::vector<unsigned int> order;
+	std::atomic<int> threadsAvailable;
+};
+
+}
+
+static void appendSubtree(std::vector<BvhNode>& out, const std::vector<BvhNode>& subtree) {
+	unsigned int base = out.size();
+	for (size_t i = 0; i < subtree.size(); ++i) {
+		BvhNode node = subtree[i];
+		if (node.count == 0) {
+			node.offset += base;
+		}
+		out.push_back(node);
+	}
+}
+
+static void buildNode(BuildContext& ctx, unsigned int first, unsigned int count, std::vector<BvhNode>& out);
+
+struct InLeftBins {
+	const float* centroids;
+	unsigned int axis;
+	float lo;
+	float scale;
+	unsigned int bins;
+	unsigned int lastBin;
+
+	bool operator()(unsigned int t) const {
+		return std::min(bins - 1, (unsigned int)((centroids[t * 3 + axis] - lo) * scale)) <= lastBin;
+	}
+};
+
+// Returns the number of triangles that go to the left child, 0 if no split helps.
+static unsigned int partitionBinned(BuildContext& ctx, unsigned int first, unsigned int count, const Box& centroidBounds) {
+	const unsigned int bins = std::max(2u, ctx.options->bins);
+	std::vector<Box> binBounds(bins);
+	std::vector<unsigned int> binCounts(bins);
+	std::vector<float> rightAreas(bins);
+
+	float bestCost = FLT_MAX;
+	int bestAxis = -1;
+	unsigned int bestBin = 0;
+
+	for (unsigned int axis = 0; axis < 3; ++axis) {
+		float lo = centroidBounds.min[axis];
+		float extent = centroidBounds.max[axis] - lo;
+		if (extent <= 0.0f) {
+			continue;
+		}
+		float scale = bins / extent;
+
+		std::fill(binBounds.begin(), binBounds.end(), Box());
+		std::fill(binCounts.begin(), binCounts.end(), 0);
+		for (unsigned int i = first; i < first + count; ++i) {
+			unsigned int t = ctx.order[i];
+			unsigned int bin = std::min(bins - 1, (unsigned int)((ctx.centroids[t * 3 + axis] - lo) * scale));
+			binBounds[bin].grow(ctx.triangleBounds[t]);
+			++binCounts[bin];
+		}
+
+		Box right;
+		for (unsigned int b = bins - 1; b > 0; --b) {
+			right.grow(binBounds[b]);
+			rightAreas[b] = right.area();
+		}
+
+		Box left;
+		unsigned int leftCount = 0;
+		for (unsigned int b = 0; b + 1 < bins; ++b) {
+			left.grow(binBounds[b]);
+			leftCount += binCounts[b];
+			float cost = left.area() * leftCount + rightAreas[b + 1] * (count - leftCount);
+			if (leftCount > 0 && leftCount < count && cost < bestCost) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = b;
+			}
+		}
+	}
+
+	if (bestAxis < 0) {
+		return 0;
+	}
+
+	float lo = centroidBounds.min[bestAxis];
+	float scale = bins / (centroidBounds.max[bestAxis] - lo);
+	unsigned int* begin = &ctx.order[first];
+	InLeftBins inLeft = { &ctx.centroids[0], (unsigned int)bestAxis, lo, scale, bins, bestBin };
+	unsigned int* middle = std::partition(begin, begin + count, inLeft);
+	return middle - begin;
+}
+
+static void buildNode(BuildContext& ctx, unsigned int first, unsigned int count, std::vector<BvhNode>& out) {
+	Box bounds, centroidBounds;
+	for (unsigned int i = first; i < first + count; ++i) {
+		unsigned int t = ctx.order[i];
+		bounds.grow(ctx.triangleBounds[t]);
+		centroidBounds.grow(&ctx.centroids[t * 3]);
+	}
+
+	unsigned int index = out.size();
+	BvhNode node;
+	std::copy(bounds.min, bounds.min + 3, node.min);
+	std::copy(bounds.max, bounds.max + 3, node.max);
+	node.offset = first;
+	node.count = count;
+	out.push_back(node);
+
+	if (count <= ctx.options->maxLeafTriangles) {
+		return;
+	}
+
+	unsigned int leftCount = partitionBinned(ctx, first, count, centroidBounds);
+	if (leftCount == 0) {
+		// Every centroid coincides; split the range in half to keep leaves small.
+		leftCount = count / 2;
+	}
+	unsigned int rightCount = count - leftCount;
+	out[index].count = 0;
+
+	bool parallel = count > ctx.options->parallelThreshold && ctx.threadsAvailable.fetch_sub(1) > 0;
+	if (parallel) {
+		std::vector<BvhNode> left, right;
+		std::thread thread(buildNode, std::ref(ctx), first, leftCount, std::ref(left));
+		buildNode(ctx, first + leftCount, rightCount, right);
+		thread.join();
+		ctx.threadsAvailable++;
+
+		appendSubtree(out, left);
+		out[index].offset = out.size();
+		appendSubtree(out, right);
+	} else {
+		if (count > ctx.options->parallelThreshold) {
+			ctx.threadsAvailable++;
+		}
+		buildNode(ctx, first, leftCount, out);
+		out[index].offset = out.size();
+		buildNode(ctx, first + leftCount, rightCount, out);
+	}
+}
+
+Bvh buildBvh(const Mesh& mesh, const BvhOptions& options) {
+	StageAllocations stageAllocations("buildBvh");
+	std::cout << "\n\nBuilding BVH.";
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	Bvh bvh;
+	bvh.sahCost = 0.0f;
+	bvh.buildMilliseconds = 0.0f;
+
+	unsigned int numTriangles = mesh.index.size() / 3;
+	if (numTriangles == 0) {
+		return bvh;
+	}
+
+	BuildContext ctx;
+	ctx.options = &options;
+	unsigned int threadCount = options.threadCount ? options.threadCount : std::thread::hardware_concurrency();
+	ctx.threadsAvailable = std::max(1u, threadCount) - 1;
+	ctx.triangleBounds.resize(numTriangles);
+	ctx.centroids.resize(numTriangles * 3);
+	ctx.order.resize(numTriangles);
+	for (unsigned int t = 0; t < numTriangles; ++t) {
+		Box& box = ctx.triangleBounds[t];
+		for (unsigned int k = 0; k < 3; ++k) {
+			const aiVector3D& p = mesh.vertex[mesh.index[t * 3 + k]];
+			float point[3] = { p.x, p.y, p.z };
+			box.grow(point);
+		}
+		for (unsigned int c = 0; c < 3; ++c) {
+			ctx.centroids[t * 3 + c] = (box.min[c] + box.max[c]) * 0.5f;
+		}
+		ctx.order[t] = t;
+	}
+
+	bvh.nodes.reserve(numTriangles * 2 / std::max(1u, options.maxLeafTriangles) + 1);
+	buildNode(ctx, 0, numTriangles, bvh.nodes);
+
+	bvh.index.resize(numTriangles * 3);
+	for (unsigned int i = 0; i < numTriangles; ++i) {
+		std::copy(&mesh.index[ctx.order[i] * 3], &mesh.index[ctx.order[i] * 3] + 3, &bvh.index[i * 3]);
+	}
+
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+	bvh.buildMilliseconds = std::chrono::duration<float, std::milli>(end - start).count();
+
+	Box root;
+	root.grow(bvh.nodes[0].min);
+	root.grow(bvh.nodes[0].max);
+	float rootArea = std::max(root.area(), FLT_MIN);
+	double cost = 0.0;
+	for (size_t i = 0; i < bvh.nodes.size(); ++i) {
+		Box box;
+		box.grow(bvh.nodes[i].min);
+		box.grow(bvh.nodes[i].max);
+		cost += box.area() / rootArea * (bvh.nodes[i].count == 0 ? 1.0 : bvh.nodes[i].count);
+	}
+	bvh.sahCost = (float)cost;
+
+	std::cout << "\nNum Nodes: " << bvh.nodes.size();
+	std::cout << "\nBuild time: " << bvh.buildMilliseconds << " ms";
+	std::cout << "\nSAH cost: " << bvh.sahCost;
+	return bvh;
+}
+
+Json::Value bvhToJson(const Bvh& bvh, bool base64) {
+	std::vector<float> bounds;
+	std::vector<unsigned int> offsets;
+	bounds.reserve(bvh.nodes.size() * 6);
+	offsets.reserve(bvh.nodes.size() * 2);
+	for (size_t i = 0; i < bvh.nodes.size(); ++i) {
+		const BvhNode& node = bvh.nodes[i];
+		bounds.insert(bounds.end(), node.min, node.min + 3);
+		bounds.insert(bounds.end(), node.max, node.max + 3);
+		offsets.push_back(node.offset);
+		offsets.push_back(node.count);
+	}
+
+	Json::Value root;
+	root["sahCost"] = bvh.sahCost;
+	root["buildTime"] = bvh.buildMilliseconds;
+	root.emplace("bounds", typedArrayToJson("Float32Array", 6, bounds, base64));
+	root.emplace("offsets", typedArrayToJson("Uint32Array", 2, offsets, base64));
+	root.emplace("index", indexArrayToJson(bvh.index, base64));
+	return root;
+}
@@ -0,0 +1,58 @@
+#ifndef ASSIMP_TO_JSON_BVH_H
+#define ASSIMP_TO_JSON_BVH_H
+
+#include <vector>
+
+#include <json\json.h>
+
+#include "mesh.h"
+
+/*
+
+Offline bounding volume hierarchy over the mesh triangles, so the web client can raycast
+(picking) against a ready-made tree instead of building one at load time.
+
+Splits are chosen with a binned surface area heuristic. Subtrees larger than
+parallelThreshold triangles are built on their own thread, up to threadCount threads.
+
+Nodes are stored depth-first in a flat array, and a node's left child always follows
+it directly. For node n:
+	bounds[6n .. 6n+5]    min x, y, z, max x, y, z
+	offsets[2n], [2n+1]   leaf: first triangle and triangle count
+	                      inner node: index of the right child, and 0
+Leaves refer to "index", the mesh triangle list reordered so that every leaf's
+triangles are contiguous.
+
+*/
+
+struct BvhOptions {
+	BvhOptions() : maxLeafTriangles(4), bins(16), parallelThreshold(1 << 14), threadCount(0) {}
+
+	unsigned int maxLeafTriangles;
+	unsigned int bins;
+	unsigned int parallelThreshold;
+	// 0 uses std::thread::hardware_concurrency().
+	unsigned int threadCount;
+};
+
+struct BvhNode {
+	float min[3];
+	float max[3];
+	unsigned int offset;
+	unsigned int count;
+};
+
+struct Bvh {
+	std::vector<BvhNode> nodes;
+	// Mesh::index with the triangles in leaf order.
+	std::vector<unsigned int> index;
+	// Expected intersection cost: traversal steps plus triangle tests per ray, relative to the root box.
+	float sahCost;
+	float buildMilliseconds;
+};
+
+Bvh buildBvh(const Mesh& mesh, const BvhOptions& options);
+
+Json::Value bvhToJson(const Bvh& bvh, bool base64);
+
+#endif
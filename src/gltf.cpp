@@ -0,0 +1,399 @@
+#include <iostream>
+#include <fstream>
+#include <utility>
+
+#include <json\json.h>
+
+#include "gltf.h"
+#include "allocationcounter.h"
+
+// glTF accessor component types and buffer view targets.
+static const int GL_UNSIGNED_SHORT = 5123;
+static const int GL_UNSIGNED_INT = 5125;
+static const int GL_FLOAT = 5126;
+static const int GL_ARRAY_BUFFER = 34962;
+static const int GL_ELEMENT_ARRAY_BUFFER = 34963;
+
+// Accumulates the binary buffer together with the bufferViews/accessors describing it.
+class GltfBuffer {
+public:
+	GltfBuffer() : bufferViews(Json::arrayValue), accessors(Json::arrayValue) {}
+
+	int addFloatAccessor(const std::vector<float>& values, unsigned int components, const char* type, int target, bool bounds) {
+		Json::Value accessor = makeAccessor(values.empty() ? NULL : &values[0], values.size() * sizeof(float), values.size() / components, GL_FLOAT, type, target);
+		if (bounds && !values.empty()) {
+			Json::Value& min = accessor.emplace("min", Json::Value(Json::arrayValue));
+			Json::Value& max = accessor.emplace("max", Json::Value(Json::arrayValue));
+			for (unsigned int c = 0; c < components; ++c) {
+				float lo = values[c], hi = values[c];
+				for (size_t i = c; i < values.size(); i += components) {
+					if (values[i] < lo) lo = values[i];
+					if (values[i] > hi) hi = values[i];
+				}
+				min.append(lo);
+				max.append(hi);
+			}
+		}
+		return appendAccessor(std::move(accessor));
+	}
+
+	int addUnsignedShortAccessor(const std::vector<unsigned short>& values, unsigned int components, const char* type, int target) {
+		return appendAccessor(makeAccessor(values.empty() ? NULL : &values[0], values.size() * sizeof(unsigned short), values.size() / components, GL_UNSIGNED_SHORT, type, target));
+	}
+
+	// 16-bit when every index fits.
+	int addIndexAccessor(const std::vector<unsigned int>& values) {
+		if (fitsInUnsignedShort(values)) {
+			return addUnsignedShortAccessor(narrowIndices(values), 1, "SCALAR", GL_ELEMENT_ARRAY_BUFFER);
+		}
+		return appendAccessor(makeAccessor(values.empty() ? NULL : &values[0], values.size() * sizeof(unsigned int), values.size(), GL_UNSIGNED_INT, "SCALAR", GL_ELEMENT_ARRAY_BUFFER));
+	}
+
+	std::vector<unsigned char> bytes;
+	Json::Value bufferViews;
+	Json::Value accessors;
+
+private:
+	Json::Value makeAccessor(const void* data, size_t byteLength, size_t count, int componentType, const char* type, int target) {
+		// Every view starts on a 4 byte boundary so float data stays aligned.
+		bytes.resize((bytes.size() + 3) & ~size_t(3), 0);
+
+		Json::Value bufferView;
+		bufferView["buffer"] = 0;
+		bufferView["byteOffset"] = (Json::UInt)bytes.size();
+		bufferView["byteLength"] = (Json::UInt)byteLength;
+		if (target) {
+			bufferView["target"] = target;
+		}
+		const unsigned char* begin = static_cast<const unsigned char*>(data);
+		bytes.insert(bytes.end(), begin, begin + byteLength);
+
+		Json::Value accessor;
+		accessor["bufferView"] = bufferViews.size();
+		accessor["componentType"] = componentType;
+		accessor["count"] = (Json::UInt)count;
+		accessor["type"] = type;
+		bufferViews.append(std::move(bufferView));
+		return accessor;
+	}
+
+	int appendAccessor(Json::Value&& accessor) {
+		accessors.append(std::move(accessor));
+		return accessors.size() - 1;
+	}
+};
+
+// aiMatrix4x4 is row major, glTF wants column major.
+static void appendColumnMajor(std::vector<float>& values, const aiMatrix4x4& m) {
+	for (unsigned int column = 0; column < 4; ++column) {
+		for (unsigned int row = 0; row < 4; ++row) {
+			values.push_back(m[row][column]);
+		}
+	}
+}
+
+static Json::Value floatArray(const float* values, unsigned int count) {
+	Json::Value array = Json::Value(Json::arrayValue);
+	for (unsigned int i = 0; i < count; ++i) {
+		array.append(values[i]);
+	}
+	return array;
+}
+
+// Adds one sampler plus its channel. Key times shared with an earlier sampler reuse its input accessor.
+static void addAnimationSampler(GltfBuffer& buffer, std::map< std::vector<float>, int >& inputAccessors,
+	Json::Value& animation, int node, const char* path, const std::vector<float>& times,
+	const std::vector<float>& values, unsigned int components, const char* type) {
+
+	std::map< std::vector<float>, int >::const_iterator input = inputAccessors.find(times);
+	int inputAccessor;
+	if (input != inputAccessors.end()) {
+		inputAccessor = input->second;
+	} else {
+		inputAccessor = buffer.addFloatAccessor(times, 1, "SCALAR", 0, true);
+		inputAccessors[times] = inputAccessor;
+	}
+
+	Json::Value sampler;
+	sampler["input"] = inputAccessor;
+	sampler["output"] = buffer.addFloatAccessor(values, components, type, 0, false);
+	sampler["interpolation"] = "LINEAR";
+
+	Json::Value channel;
+	channel["sampler"] = animation["samplers"].size();
+	channel["target"]["node"] = node;
+	channel["target"]["path"] = path;
+
+	animation["samplers"].append(std::move(sampler));
+	animation["channels"].append(std::move(channel));
+}
+
+static Json::Value buildPrimitive(const Mesh& mesh, GltfBuffer& buffer) {
+	Json::Value primitive;
+	Json::Value& attributes = primitive.emplace("attributes", Json::Value(Json::objectValue));
+	attributes["POSITION"] = buffer.addFloatAccessor(flatten(mesh.vertex, mesh.vertex.size(), 3), 3, "VEC3", GL_ARRAY_BUFFER, true);
+	if (!mesh.normal.empty()) {
+		attributes["NORMAL"] = buffer.addFloatAccessor(flatten(mesh.normal, mesh.normal.size(), 3), 3, "VEC3", GL_ARRAY_BUFFER, false);
+	}
+	if (!mesh.tangent.empty()) {
+		attributes["TANGENT"] = buffer.addFloatAccessor(tangentsWithSign(mesh), 4, "VEC4", GL_ARRAY_BUFFER, false);
+	}
+	if (!mesh.uv.empty()) {
+		attributes["TEXCOORD_0"] = buffer.addFloatAccessor(flatten(mesh.uv, mesh.vertex.size(), 2), 2, "VEC2", GL_ARRAY_BUFFER, false);
+	}
+	if (!mesh.bones.empty()) {
+		std::vector<unsigned short> joints;
+		std::vector<float> weights;
+		collectSkinInfluences(mesh, influencesPerVertex, joints, weights);
+		attributes["JOINTS_0"] = buffer.addUnsignedShortAccessor(joints, influencesPerVertex, "VEC4", GL_ARRAY_BUFFER);
+		attributes["WEIGHTS_0"] = buffer.addFloatAccessor(weights, influencesPerVertex, "VEC4", GL_ARRAY_BUFFER, false);
+	}
+	if (!mesh.index.empty()) {
+		primitive["indices"] = buffer.addIndexAccessor(mesh.index);
+	}
+	primitive["mode"] = 4;
+	if (mesh.diffuseMap.length() > 0) {
+		primitive["material"] = 0;
+	}
+
+	return primitive;
+}
+
+// bones is the table from bonesByIndex(); node i + 1 is bone i.
+static Json::Value buildGltf(const Mesh& mesh, const std::vector<const MeshBone*>& bones, const GltfOptions& options, GltfBuffer& buffer) {
+	Json::Value root;
+
+	Json::Value asset;
+	asset["version"] = "2.0";
+	asset["generator"] = "assimp-to-json converter";
+	root.emplace("asset", std::move(asset));
+
+	std::vector<std::string> boneNames(bones.size());
+	for (MeshBonesConstIterator i = mesh.bones.begin(); i != mesh.bones.end(); ++i) {
+		boneNames[i->second.index] = i->first;
+	}
+
+	Json::Value gltfMesh;
+	gltfMesh["name"] = mesh.name;
+	IndexLayout layout = chooseIndexLayout(mesh, options.indexSplit);
+	if (layout.subMeshes.empty()) {
+		gltfMesh["primitives"].append(buildPrimitive(mesh, buffer));
+	} else {
+		for (size_t i = 0; i < layout.subMeshes.size(); ++i) {
+			gltfMesh["primitives"].append(buildPrimitive(extractSubMesh(mesh, layout.subMeshes[i]), buffer));
+		}
+	}
+	root["meshes"].append(std::move(gltfMesh));
+
+	if (mesh.diffuseMap.length() > 0) {
+		Json::Value image;
+		image["uri"] = mesh.diffuseMap;
+		root["images"].append(std::move(image));
+
+		Json::Value texture;
+		texture["source"] = 0;
+		root["textures"].append(std::move(texture));
+
+		Json::Value material;
+		material["pbrMetallicRoughness"]["baseColorTexture"]["index"] = 0;
+		material["pbrMetallicRoughness"]["metallicFactor"] = 0;
+		root["materials"].append(std::move(material));
+	}
+
+	Json::Value nodes = Json::Value(Json::arrayValue);
+	Json::Value sceneNodes = Json::Value(Json::arrayValue);
+
+	Json::Value meshNode;
+	meshNode["name"] = mesh.name;
+	meshNode["mesh"] = 0;
+	if (!mesh.bones.empty()) {
+		meshNode["skin"] = 0;
+	}
+	nodes.append(std::move(meshNode));
+	sceneNodes.append(0);
+
+	if (!mesh.bones.empty()) {
+		Json::Value skin;
+		Json::Value& joints = skin.emplace("joints", Json::Value(Json::arrayValue));
+		std::vector<float> inverseBindMatrices;
+		inverseBindMatrices.reserve(bones.size() * 16);
+
+		for (size_t i = 0; i < bones.size(); ++i) {
+			const MeshBone& bone = *bones[i];
+
+			aiVector3D scaling; aiQuaternion rotation; aiVector3D position;
+			bone.nodeTransform.Decompose(scaling, rotation, position);
+			float translation[3] = { position.x, position.y, position.z };
+			float quaternion[4] = { rotation.x, rotation.y, rotation.z, rotation.w };
+			float scale[3] = { scaling.x, scaling.y, scaling.z };
+
+			Json::Value node;
+			node["name"] = boneNames[i];
+			node.emplace("translation", floatArray(translation, 3));
+			node.emplace("rotation", floatArray(quaternion, 4));
+			node.emplace("scale", floatArray(scale, 3));
+			nodes.append(std::move(node));
+
+			joints.append((int)i + 1);
+			appendColumnMajor(inverseBindMatrices, bone.offsetMatrix);
+		}
+
+		for (size_t i = 0; i < bones.size(); ++i) {
+			int parent = bones[i]->pindex;
+			if (parent < 0) {
+				sceneNodes.append((int)i + 1);
+			} else {
+				nodes[parent + 1]["children"].append((int)i + 1);
+			}
+		}
+
+		skin["inverseBindMatrices"] = buffer.addFloatAccessor(inverseBindMatrices, 16, "MAT4", 0, false);
+		root["skins"].append(std::move(skin));
+	}
+
+	root.emplace("nodes", std::move(nodes));
+
+	Json::Value scene;
+	scene.emplace("nodes", std::move(sceneNodes));
+	root["scenes"].append(std::move(scene));
+	root["scene"] = 0;
+
+	std::map< std::vector<float>, int > inputAccessors;
+	for (AnimationInfoConstIterator it = mesh.animations.begin(); it != mesh.animations.end(); ++it) {
+		const std::string& animationName = it->first;
+		float ticksPerSecond = it->second.fps > 0.0f ? it->second.fps : defaultTicksPerSecond;
+
+		Json::Value animation;
+		animation["name"] = animationName;
+		animation["samplers"] = Json::Value(Json::arrayValue);
+		animation["channels"] = Json::Value(Json::arrayValue);
+
+		for (size_t i = 0; i < bones.size(); ++i) {
+			AnimationKeysConstIterator keysIt = bones[i]->animations.find(animationName);
+			if (keysIt == bones[i]->animations.end()) {
+				continue;
+			}
+			const AnimationKeys& keys = keysIt->second;
+			int node = (int)i + 1;
+
+			if (!keys.positionKeys.empty()) {
+				std::vector<float> times, values;
+				for (size_t k = 0; k < keys.positionKeys.size(); ++k) {
+					const aiVectorKey& key = keys.positionKeys[k];
+					times.push_back(float(key.mTime / ticksPerSecond));
+					values.push_back(key.mValue.x); values.push_back(key.mValue.y); values.push_back(key.mValue.z);
+				}
+				addAnimationSampler(buffer, inputAccessors, animation, node, "translation", times, values, 3, "VEC3");
+			}
+
+			if (!keys.rotationKeys.empty()) {
+				std::vector<float> times, values;
+				for (size_t k = 0; k < keys.rotationKeys.size(); ++k) {
+					const aiQuatKey& key = keys.rotationKeys[k];
+					times.push_back(float(key.mTime / ticksPerSecond));
+					values.push_back(key.mValue.x); values.push_back(key.mValue.y);
+					values.push_back(key.mValue.z); values.push_back(key.mValue.w);
+				}
+				addAnimationSampler(buffer, inputAccessors, animation, node, "rotation", times, values, 4, "VEC4");
+			}
+
+			if (!keys.scaleKeys.empty()) {
+				std::vector<float> times, values;
+				for (size_t k = 0; k < keys.scaleKeys.size(); ++k) {
+					const aiVectorKey& key = keys.scaleKeys[k];
+					times.push_back(float(key.mTime / ticksPerSecond));
+					values.push_back(key.mValue.x); values.push_back(key.mValue.y); values.push_back(key.mValue.z);
+				}
+				addAnimationSampler(buffer, inputAccessors, animation, node, "scale", times, values, 3, "VEC3");
+			}
+		}
+
+		if (animation["channels"].size() > 0) {
+			root["animations"].append(std::move(animation));
+		}
+	}
+
+	root.emplace("bufferViews", std::move(buffer.bufferViews));
+	root.emplace("accessors", std::move(buffer.accessors));
+
+	return root;
+}
+
+static void writeUInt32(std::ofstream& file, unsigned int value) {
+	unsigned char bytes[4] = {
+		(unsigned char)(value), (unsigned char)(value >> 8), (unsigned char)(value >> 16), (unsigned char)(value >> 24)
+	};
+	file.write(reinterpret_cast<const char*>(bytes), 4);
+}
+
+bool writeGltf(const std::string& filePath, const Mesh& mesh, const GltfOptions& options) {
+	StageAllocations stageAllocations("writeGltf");
+	std::cout << "\n\nBuilding glTF.";
+
+	std::vector<const MeshBone*> bones;
+	std::string error;
+	if (!bonesByIndex(mesh, bones, error)) {
+		std::cout << "\nCannot build the skin: " << error << ".";
+		return false;
+	}
+
+	GltfBuffer buffer;
+	Json::Value root = buildGltf(mesh, bones, options, buffer);
+	buffer.bytes.resize((buffer.bytes.size() + 3) & ~size_t(3), 0);
+
+	Json::Value gltfBuffer;
+	gltfBuffer["byteLength"] = (Json::UInt)buffer.bytes.size();
+
+	if (options.binary) {
+		root["buffers"].append(std::move(gltfBuffer));
+
+		Json::FastWriter writer;
+		std::string json = writer.write(root);
+		json.resize((json.size() + 3) & ~size_t(3), ' ');
+
+		std::ofstream file(filePath.c_str(), std::ios::binary);
+		if (!file) {
+			std::cout << "\nCould not open " << filePath;
+			return false;
+		}
+		writeUInt32(file, 0x46546C67); // "glTF"
+		writeUInt32(file, 2);
+		writeUInt32(file, 12 + 8 + json.size() + 8 + buffer.bytes.size());
+		writeUInt32(file, json.size());
+		writeUInt32(file, 0x4E4F534A); // "JSON"
+		file.write(json.data(), json.size());
+		writeUInt32(file, buffer.bytes.size());
+		writeUInt32(file, 0x004E4942); // "BIN"
+		if (!buffer.bytes.empty()) {
+			file.write(reinterpret_cast<const char*>(&buffer.bytes[0]), buffer.bytes.size());
+		}
+	} else {
+		size_t extension = filePath.find_last_of('.');
+		size_t directory = filePath.find_last_of("/\\");
+		std::string stem = (extension != std::string::npos && (directory == std::string::npos || extension > directory))
+			? filePath.substr(0, extension) : filePath;
+		std::string binPath = stem + ".bin";
+		gltfBuffer["uri"] = directory == std::string::npos ? binPath : binPath.substr(directory + 1);
+		root["buffers"].append(std::move(gltfBuffer));
+
+		std::ofstream bin(binPath.c_str(), std::ios::binary);
+		if (!bin) {
+			std::cout << "\nCould not open " << binPath;
+			return false;
+		}
+		if (!buffer.bytes.empty()) {
+			bin.write(reinterpret_cast<const char*>(&buffer.bytes[0]), buffer.bytes.size());
+		}
+
+		Json::StyledWriter writer;
+		std::ofstream file(filePath.c_str());
+		if (!file) {
+			std::cout << "\nCould not open " << filePath;
+			return false;
+		}
+		file << writer.write(root);
+	}
+
+	std::cout << "\nDone writing glTF.";
+	return true;
+}
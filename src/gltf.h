@@ -0,0 +1,36 @@
+#ifndef ASSIMP_TO_JSON_GLTF_H
+#define ASSIMP_TO_JSON_GLTF_H
+
+#include <string>
+
+#include "mesh.h"
+#include "indexsplit.h"
+
+/*
+
+glTF 2.0 backend. It reads the same Mesh that the three.js writers use, so one import
+feeds every output format.
+
+The mesh becomes node 0 and bone i becomes node i + 1. Bones are linked through pindex,
+and their offset matrices become the skin's inverseBindMatrices. Each animation becomes
+a glTF animation with one sampler per bone and key type. Samplers whose key times are
+identical share one input accessor. Key times are converted from ticks to seconds.
+
+Indices are 16-bit up to 65,535 vertices. Larger meshes become one primitive per sub-mesh
+from chooseIndexLayout(), all sharing the skin, or one primitive with 32-bit indices.
+
+By default this writes <name>.gltf plus <name>.bin. With binary set, it writes one .glb
+holding the JSON chunk and the BIN chunk.
+
+*/
+
+struct GltfOptions {
+	GltfOptions() : binary(false) {}
+
+	bool binary;
+	IndexSplitOptions indexSplit;
+};
+
+bool writeGltf(const std::string& filePath, const Mesh& mesh, const GltfOptions& options);
+
+#endif
@@ -0,0 +1,185 @@
+#include "indexcodec.h"
+
+static const unsigned char indexCodecVersion = 1;
+static const unsigned int edgeFifoSize = 16;
+// Nibble value 15 marks a triangle without a shared edge, so only 15 entries are addressable.
+static const unsigned int noEdge = 15;
+
+namespace {
+
+struct EdgeFifo {
+	EdgeFifo() : head(0) {
+		for (unsigned int i = 0; i < edgeFifoSize; ++i) {
+			edges[i][0] = edges[i][1] = ~0u;
+		}
+	}
+
+	// Stores the edge as the neighbouring triangle will see it: reversed.
+	void push(unsigned int a, unsigned int b) {
+		edges[head][0] = b;
+		edges[head][1] = a;
+		head = (head + 1) & (edgeFifoSize - 1);
+	}
+
+	const unsigned int* get(unsigned int age) const {
+		return edges[(head - 1 - age) & (edgeFifoSize - 1)];
+	}
+
+	unsigned int edges[edgeFifoSize][2];
+	unsigned int head;
+};
+
+}
+
+static void writeVarint(std::vector<unsigned char>& out, unsigned int v, unsigned int& last) {
+	int delta = int(v - last);
+	unsigned int zigzag = ((unsigned int)delta << 1) ^ (unsigned int)(delta >> 31);
+	while (zigzag >= 0x80) {
+		out.push_back((unsigned char)(zigzag | 0x80));
+		zigzag >>= 7;
+	}
+	out.push_back((unsigned char)zigzag);
+	last = v;
+}
+
+std::vector<unsigned char> encodeIndexStream(const std::vector<unsigned int>& index) {
+	std::vector<unsigned char> out;
+	out.reserve(index.size() + 1);
+	out.push_back(indexCodecVersion);
+
+	EdgeFifo fifo;
+	unsigned int next = 0;
+	unsigned int last = 0;
+
+	for (size_t i = 0; i + 2 < index.size(); i += 3) {
+		const unsigned int* t = &index[i];
+
+		// Prefer a shared edge whose third vertex is "next", then the most recent edge.
+		int bestAge = -1, bestCorner = 0;
+		for (unsigned int age = 0; age < noEdge; ++age) {
+			const unsigned int* edge = fifo.get(age);
+			for (unsigned int corner = 0; corner < 3; ++corner) {
+				if (t[corner] == edge[0] && t[(corner + 1) % 3] == edge[1]) {
+					bool isNext = t[(corner + 2) % 3] == next;
+					if (bestAge < 0 || (isNext && t[(bestCorner + 2) % 3] != next)) {
+						bestAge = age;
+						bestCorner = corner;
+					}
+				}
+			}
+		}
+
+		if (bestAge >= 0) {
+			unsigned int a = t[bestCorner], b = t[(bestCorner + 1) % 3], c = t[(bestCorner + 2) % 3];
+			bool isNext = c == next;
+			out.push_back((unsigned char)((bestAge << 4) | (bestCorner << 1) | (isNext ? 0 : 1)));
+			if (isNext) {
+				++next;
+			} else {
+				writeVarint(out, c, last);
+				if (c >= next) {
+					next = c + 1;
+				}
+			}
+			fifo.push(b, c);
+			fifo.push(c, a);
+			continue;
+		}
+
+		size_t code = out.size();
+		out.push_back((unsigned char)(noEdge << 4));
+		for (unsigned int k = 0; k < 3; ++k) {
+			if (t[k] == next) {
+				out[code] |= 1 << k;
+				++next;
+			} else {
+				writeVarint(out, t[k], last);
+				if (t[k] >= next) {
+					next = t[k] + 1;
+				}
+			}
+		}
+		fifo.push(t[0], t[1]);
+		fifo.push(t[1], t[2]);
+		fifo.push(t[2], t[0]);
+	}
+
+	return out;
+}
+
+static inline bool readVarint(const unsigned char*& p, const unsigned char* end, unsigned int& last) {
+	unsigned int zigzag = 0;
+	for (unsigned int shift = 0; shift < 35; shift += 7) {
+		if (p == end) {
+			return false;
+		}
+		unsigned char byte = *p++;
+		zigzag |= unsigned(byte & 0x7f) << shift;
+		if (byte < 0x80) {
+			last += (zigzag >> 1) ^ (0u - (zigzag & 1));
+			return true;
+		}
+	}
+	return false;
+}
+
+bool decodeIndexStream(const unsigned char* data, size_t size, unsigned int* index, size_t indexCount) {
+	if (size < 1 || data[0] != indexCodecVersion || indexCount % 3 != 0) {
+		return false;
+	}
+	const unsigned char* p = data + 1;
+	const unsigned char* end = data + size;
+
+	EdgeFifo fifo;
+	unsigned int next = 0;
+	unsigned int last = 0;
+
+	for (size_t i = 0; i < indexCount; i += 3) {
+		if (p == end) {
+			return false;
+		}
+		unsigned int code = *p++;
+		unsigned int* t = &index[i];
+
+		if ((code >> 4) != noEdge) {
+			const unsigned int* edge = fifo.get(code >> 4);
+			unsigned int corner = (code >> 1) & 3;
+			if (corner > 2) {
+				return false;
+			}
+			unsigned int a = edge[0], b = edge[1], c;
+			if (code & 1) {
+				if (!readVarint(p, end, last)) {
+					return false;
+				}
+				c = last;
+				next = c >= next ? c + 1 : next;
+			} else {
+				c = next++;
+			}
+			t[corner] = a;
+			t[corner == 2 ? 0 : corner + 1] = b;
+			t[corner == 0 ? 2 : corner - 1] = c;
+			fifo.push(b, c);
+			fifo.push(c, a);
+			continue;
+		}
+
+		for (unsigned int k = 0; k < 3; ++k) {
+			if (code & (1 << k)) {
+				t[k] = next++;
+			} else {
+				if (!readVarint(p, end, last)) {
+					return false;
+				}
+				t[k] = last;
+				next = last >= next ? last + 1 : next;
+			}
+		}
+		fifo.push(t[0], t[1]);
+		fifo.push(t[1], t[2]);
+		fifo.push(t[2], t[0]);
+	}
+
+	return p == end;
+}
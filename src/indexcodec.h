@@ -0,0 +1,36 @@
+#ifndef ASSIMP_TO_JSON_INDEX_CODEC_H
+#define ASSIMP_TO_JSON_INDEX_CODEC_H
+
+#include <cstddef>
+#include <vector>
+
+/*
+
+Compact byte stream for triangle lists. After a version byte, every triangle starts with
+a code byte.
+
+	high nibble 0-14   The triangle shares an edge with a recent triangle. The nibble
+	                   selects it from a 15 entry edge FIFO, newest first. In the low
+	                   nibble, bits 1-2 give the corner the shared edge starts at. Bit 0
+	                   is clear when the third vertex is "next" and set when it follows
+	                   as a varint.
+	high nibble 15     No shared edge. Bit k of the low nibble is set when vertex k is
+	                   "next"; the others follow as varints, in order.
+
+"next" is one past the highest vertex seen so far, which is what a new vertex usually is
+in a cache-ordered mesh. A varint holds the zigzag encoded difference from the previous
+varint coded vertex, 7 bits per byte, low bits first. Triangles decode with their source
+winding and corner order.
+
+The stream does not record the index count; the decoder is told how many to expect.
+bench/index_codec.cpp checks the round trip and measures size and decode speed.
+
+*/
+
+std::vector<unsigned char> encodeIndexStream(const std::vector<unsigned int>& index);
+
+// Decodes indexCount indices (a multiple of 3). Returns false when the stream is truncated,
+// has trailing bytes or was written by another version.
+bool decodeIndexStream(const unsigned char* data, size_t size, unsigned int* index, size_t indexCount);
+
+#endif
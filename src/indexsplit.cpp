@@ -0,0 +1,243 @@
+#include <iostream>
+#include <algorithm>
+#include <utility>
+#include <cfloat>
+
+#include "indexsplit.h"
+#include "allocationcounter.h"
+
+// Spreads the low 10 bits of v out to every third bit.
+static unsigned int spreadBits(unsigned int v) {
+	v &= 0x3ff;
+	v = (v | (v << 16)) & 0x030000ff;
+	v = (v | (v << 8)) & 0x0300f00f;
+	v = (v | (v << 4)) & 0x030c30c3;
+	v = (v | (v << 2)) & 0x09249249;
+	return v;
+}
+
+// Triangles sorted along a Morton curve through their centroids.
+static std::vector<unsigned int> mortonOrder(const Mesh& mesh, size_t numTriangles) {
+	float lo[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float hi[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (size_t v = 0; v < mesh.vertex.size(); ++v) {
+		for (unsigned int c = 0; c < 3; ++c) {
+			lo[c] = std::min(lo[c], mesh.vertex[v][c]);
+			hi[c] = std::max(hi[c], mesh.vertex[v][c]);
+		}
+	}
+	float scale[3];
+	for (unsigned int c = 0; c < 3; ++c) {
+		scale[c] = hi[c] > lo[c] ? 1023.0f / (hi[c] - lo[c]) : 0.0f;
+	}
+
+	std::vector< std::pair<unsigned int, unsigned int> > keys(numTriangles);
+	for (size_t t = 0; t < numTriangles; ++t) {
+		aiVector3D centroid = (mesh.vertex[mesh.index[t * 3 + 0]] + mesh.vertex[mesh.index[t * 3 + 1]] + mesh.vertex[mesh.index[t * 3 + 2]]) * (1.0f / 3.0f);
+		unsigned int code = 0;
+		for (unsigned int c = 0; c < 3; ++c) {
+			float q = (centroid[c] - lo[c]) * scale[c];
+			code |= spreadBits((unsigned int)std::min(std::max(q, 0.0f), 1023.0f)) << c;
+		}
+		keys[t] = std::make_pair(code, (unsigned int)t);
+	}
+	std::sort(keys.begin(), keys.end());
+
+	std::vector<unsigned int> order(numTriangles);
+	for (size_t t = 0; t < numTriangles; ++t) {
+		order[t] = keys[t].second;
+	}
+	return order;
+}
+
+// Fills sub-meshes with the triangles in the given order, starting a new one whenever the
+// next triangle would take the current one past maxVertices.
+static std::vector<SubMesh> partition(const Mesh& mesh, const std::vector<unsigned int>& order, unsigned int maxVertices) {
+	std::vector<SubMesh> subMeshes;
+	// Number of the last sub-mesh (counting from 1) that took each vertex.
+	std::vector<unsigned int> owner(mesh.vertex.size(), 0);
+
+	for (size_t i = 0; i < order.size(); ++i) {
+		const unsigned int* triangle = &mesh.index[order[i] * 3];
+		unsigned int current = subMeshes.size();
+
+		unsigned int added = 0;
+		for (unsigned int k = 0; k < 3; ++k) {
+			bool repeated = (k > 0 && triangle[k] == triangle[0]) || (k > 1 && triangle[k] == triangle[1]);
+			if (!repeated && owner[triangle[k]] != current) {
+				++added;
+			}
+		}
+		if (subMeshes.empty() || subMeshes.back().vertices.size() + added > maxVertices) {
+			subMeshes.push_back(SubMesh());
+			current = subMeshes.size();
+		}
+
+		SubMesh& subMesh = subMeshes.back();
+		for (unsigned int k = 0; k < 3; ++k) {
+			if (owner[triangle[k]] != current) {
+				owner[triangle[k]] = current;
+				subMesh.vertices.push_back(triangle[k]);
+			}
+		}
+		subMesh.triangles.push_back(order[i]);
+	}
+
+	return subMeshes;
+}
+
+static size_t totalVertices(const std::vector<SubMesh>& subMeshes) {
+	size_t total = 0;
+	for (size_t i = 0; i < subMeshes.size(); ++i) {
+		total += subMeshes[i].vertices.size();
+	}
+	return total;
+}
+
+// Puts the triangles back in source order and the vertices in first use order.
+static void restoreSourceOrder(const Mesh& mesh, std::vector<SubMesh>& subMeshes) {
+	std::vector<unsigned int> owner(mesh.vertex.size(), 0);
+	for (size_t i = 0; i < subMeshes.size(); ++i) {
+		SubMesh& subMesh = subMeshes[i];
+		std::sort(subMesh.triangles.begin(), subMesh.triangles.end());
+		subMesh.vertices.clear();
+		for (size_t t = 0; t < subMesh.triangles.size(); ++t) {
+			for (unsigned int k = 0; k < 3; ++k) {
+				unsigned int v = mesh.index[subMesh.triangles[t] * 3 + k];
+				if (owner[v] != i + 1) {
+					owner[v] = i + 1;
+					subMesh.vertices.push_back(v);
+				}
+			}
+		}
+	}
+}
+
+IndexLayout chooseIndexLayout(const Mesh& mesh, const IndexSplitOptions& options) {
+	IndexLayout layout;
+	if (mesh.vertex.size() <= options.maxVertices) {
+		return layout;
+	}
+
+	StageAllocations stageAllocations("chooseIndexLayout");
+	std::cout << "\n\nChoosing index width for " << mesh.vertex.size() << " vertices.";
+
+	size_t numTriangles = mesh.index.size() / 3;
+	unsigned int maxVertices = std::max(options.maxVertices, 3u);
+
+	std::vector<unsigned int> sourceOrder(numTriangles);
+	for (size_t t = 0; t < numTriangles; ++t) {
+		sourceOrder[t] = t;
+	}
+	std::vector<SubMesh> bySource = partition(mesh, sourceOrder, maxVertices);
+	std::vector<SubMesh> byMorton = partition(mesh, mortonOrder(mesh, numTriangles), maxVertices);
+	std::vector<SubMesh>& best = totalVertices(byMorton) < totalVertices(bySource) ? byMorton : bySource;
+
+	std::vector<bool> used(mesh.vertex.size(), false);
+	size_t referenced = 0;
+	for (size_t i = 0; i < numTriangles * 3; ++i) {
+		if (!used[mesh.index[i]]) {
+			used[mesh.index[i]] = true;
+			++referenced;
+		}
+	}
+
+	layout.duplicatedVertices = totalVertices(best) - referenced;
+	layout.duplication = referenced ? float(layout.duplicatedVertices) / referenced : 0.0f;
+
+	if (layout.duplication > options.maxDuplication) {
+		layout.wide = true;
+		std::cout << "\nSplitting would duplicate " << layout.duplicatedVertices << " vertices ("
+			<< layout.duplication * 100.0f << "%), using 32-bit indices.";
+		return layout;
+	}
+
+	restoreSourceOrder(mesh, best);
+	layout.subMeshes.swap(best);
+	std::cout << "\nSplit into " << layout.subMeshes.size() << " sub-meshes with 16-bit indices, duplicating "
+		<< layout.duplicatedVertices << " vertices (" << layout.duplication * 100.0f << "%).";
+	return layout;
+}
+
+Mesh extractSubMesh(const Mesh& mesh, const SubMesh& subMesh) {
+	size_t numVertices = mesh.vertex.size();
+	std::vector<int> local(numVertices, -1);
+
+	Mesh out;
+	out.name = mesh.name;
+	out.diffuseMap = mesh.diffuseMap;
+	out.normalMap = mesh.normalMap;
+	out.animations = mesh.animations;
+
+	for (size_t i = 0; i < subMesh.vertices.size(); ++i) {
+		unsigned int v = subMesh.vertices[i];
+		local[v] = i;
+		out.vertex.push_back(mesh.vertex[v]);
+		if (!mesh.normal.empty()) {
+			out.normal.push_back(mesh.normal[v]);
+		}
+		if (!mesh.tangent.empty()) {
+			out.tangent.push_back(mesh.tangent[v]);
+			out.tangentSign.push_back(mesh.tangentSign[v]);
+		}
+	}
+
+	size_t channels = numVertices ? mesh.uv.size() / numVertices : 0;
+	for (size_t c = 0; c < channels; ++c) {
+		for (size_t i = 0; i < subMesh.vertices.size(); ++i) {
+			out.uv.push_back(mesh.uv[c * numVertices + subMesh.vertices[i]]);
+		}
+	}
+
+	out.morphTargets.resize(mesh.morphTargets.size());
+	for (size_t t = 0; t < mesh.morphTargets.size(); ++t) {
+		const MorphTarget& target = mesh.morphTargets[t];
+		MorphTarget& outTarget = out.morphTargets[t];
+		outTarget.name = target.name;
+		outTarget.weight = target.weight;
+		for (size_t i = 0; i < subMesh.vertices.size(); ++i) {
+			outTarget.vertex.push_back(target.vertex[subMesh.vertices[i]]);
+			if (!target.normal.empty()) {
+				outTarget.normal.push_back(target.normal[subMesh.vertices[i]]);
+			}
+		}
+	}
+
+	out.numFaces = subMesh.triangles.size();
+	out.index.reserve(subMesh.triangles.size() * 3);
+	for (size_t t = 0; t < subMesh.triangles.size(); ++t) {
+		for (unsigned int k = 0; k < 3; ++k) {
+			out.index.push_back(local[mesh.index[subMesh.triangles[t] * 3 + k]]);
+		}
+	}
+
+	for (MeshBonesConstIterator i = mesh.bones.begin(); i != mesh.bones.end(); ++i) {
+		const MeshBone& bone = i->second;
+		MeshBone& outBone = out.bones[i->first];
+		outBone.index = bone.index;
+		outBone.pindex = bone.pindex;
+		outBone.nodeTransform = bone.nodeTransform;
+		outBone.offsetMatrix = bone.offsetMatrix;
+		outBone.parentName = bone.parentName;
+		for (std::map<int, float>::const_iterator w = bone.weights.begin(); w != bone.weights.end(); ++w) {
+			if (w->first >= 0 && size_t(w->first) < numVertices && local[w->first] >= 0) {
+				outBone.weights[local[w->first]] = w->second;
+			}
+		}
+	}
+
+	return out;
+}
+
+std::vector<unsigned short> narrowIndices(const std::vector<unsigned int>& index) {
+	return std::vector<unsigned short>(index.begin(), index.end());
+}
+
+bool fitsInUnsignedShort(const std::vector<unsigned int>& index) {
+	for (size_t i = 0; i < index.size(); ++i) {
+		if (index[i] > 0xffff) {
+			return false;
+		}
+	}
+	return true;
+}
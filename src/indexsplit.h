@@ -0,0 +1,62 @@
+#ifndef ASSIMP_TO_JSON_INDEX_SPLIT_H
+#define ASSIMP_TO_JSON_INDEX_SPLIT_H
+
+#include <vector>
+
+#include "mesh.h"
+
+/*
+
+Index width selection for the typed writers (BufferGeometry, glTF). Mesh::index is 32-bit;
+a mesh with at most maxVertices vertices is written with 16-bit indices as is.
+
+Larger meshes are split into sub-meshes of at most maxVertices vertices each, so every
+sub-mesh keeps 16-bit indices. Vertices used by triangles in two sub-meshes are duplicated.
+Triangles are grouped by locality, either in source order or along a Morton curve through
+the triangle centroids, whichever duplicates fewer vertices. Within a sub-mesh the
+triangles keep their source order, which keeps the vertex cache order of the source.
+
+When splitting would duplicate more than maxDuplication of the referenced vertices, the
+mesh is not split and is written with 32-bit indices instead.
+
+*/
+
+struct IndexSplitOptions {
+	IndexSplitOptions() : maxVertices(0xffff), maxDuplication(0.1f) {}
+
+	unsigned int maxVertices;
+	// Duplicated vertices relative to the referenced ones.
+	float maxDuplication;
+};
+
+struct SubMesh {
+	// Source vertex of every sub-mesh vertex.
+	std::vector<unsigned int> vertices;
+	// Source triangles, in source order.
+	std::vector<unsigned int> triangles;
+};
+
+struct IndexLayout {
+	IndexLayout() : wide(false), duplicatedVertices(0), duplication(0.0f) {}
+
+	// Written as one mesh with 32-bit indices.
+	bool wide;
+	// Empty unless the mesh is split.
+	std::vector<SubMesh> subMeshes;
+	// What splitting costs (or would have cost, when wide is set).
+	size_t duplicatedVertices;
+	float duplication;
+};
+
+IndexLayout chooseIndexLayout(const Mesh& mesh, const IndexSplitOptions& options);
+
+// A standalone Mesh holding the sub-mesh's vertices, with the index rebased onto them.
+// Bones keep their indices and remapped weights, but not their animation keys.
+Mesh extractSubMesh(const Mesh& mesh, const SubMesh& subMesh);
+
+// Narrows an index that fits in 16 bits.
+std::vector<unsigned short> narrowIndices(const std::vector<unsigned int>& index);
+
+bool fitsInUnsignedShort(const std::vector<unsigned int>& index);
+
+#endif
@@ -1682,6 +1682,55 @@ releaseStringValue( char *value )
       free( value );
 }
 
+
+#ifndef JSON_VALUE_USE_INTERNAL_MAP
+/** Storage of a shared (copy-on-write) array or object.
+ * Value::value_.map_ points on values_, which must stay the first member.
+ * unshareable_ is set once a non-const reference or iterator to an element
+ * has been handed out (see Value::leak()): a copy made while it may still be
+ * in use must not see writes through it, so copies clone the elements
+ * instead of sharing them until share() or ValueInternTable::intern() is
+ * called again. hash_ is only written by ValueInternTable::intern().
+ */
+struct SharedObjectValues
+{
+   SharedObjectValues()
+      : refCount_( 1 )
+      , hash_( 0 )
+      , hasHash_( false )
+      , unshareable_( false )
+   {
+   }
+
+   static SharedObjectValues *from( Value::ObjectValues *values )
+   {
+      return reinterpret_cast<SharedObjectValues *>( values );
+   }
+
+   Value::ObjectValues values_;
+   unsigned int refCount_;
+   std::size_t hash_;
+   bool hasHash_;
+   bool unshareable_;
+};
+#endif
+
+static inline std::size_t 
+combineHash( std::size_t seed, std::size_t value )
+{
+   return seed ^ ( value + 0x9e3779b9 + (seed << 6) + (seed >> 2) );
+}
+
+
+static inline std::size_t 
+hashString( const char *str )
+{
+   std::size_t hash = 2166136261u;  // FNV-1a
+   for ( ; *str; ++str )
+      hash = ( hash ^ (unsigned char)*str ) * 16777619u;
+   return hash;
+}
+
 } // namespace Json
 
 
@@ -1770,6 +1819,23 @@ Value::CZString::CZString( const CZString &other )
 {
 }
 
+#  if JSON_HAS_RVALUE_REFERENCES
+Value::CZString::CZString( CZString &&other )
+   : cstr_( other.cstr_ )
+   , index_( other.index_ )
+{
+   // A duplicateOnCopy key still points into the caller's buffer, so it is
+   // duplicated exactly as the copy constructor would. Owned strings are stolen.
+   if ( other.cstr_  &&  other.index_ == duplicateOnCopy )
+   {
+      cstr_ = duplicateStringValue( other.cstr_ );
+      index_ = duplicate;
+   }
+   else if ( other.index_ == duplicate )
+      other.cstr_ = 0;
+}
+#  endif
+
 Value::CZString::~CZString()
 {
    if ( cstr_  &&  index_ == duplicate )
@@ -1845,6 +1911,7 @@ Value::CZString::isStaticString() const
 Value::Value( ValueType type )
    : type_( type )
    , allocated_( false )
+   , shared_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
 #endif
@@ -1889,6 +1956,7 @@ Value::Value( ValueType type )
 Value::Value( UInt value )
    : type_( uintValue )
    , allocated_( false )
+   , shared_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
 #endif
@@ -1900,6 +1968,7 @@ Value::Value( UInt value )
 Value::Value( Int value )
    : type_( intValue )
    , allocated_( false )
+   , shared_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
 #endif
@@ -1913,6 +1982,7 @@ Value::Value( Int value )
 Value::Value( Int64 value )
    : type_( intValue )
    , allocated_( false )
+   , shared_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
 #endif
@@ -1925,6 +1995,7 @@ Value::Value( Int64 value )
 Value::Value( UInt64 value )
    : type_( uintValue )
    , allocated_( false )
+   , shared_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
 #endif
@@ -1937,6 +2008,7 @@ Value::Value( UInt64 value )
 Value::Value( double value )
    : type_( realValue )
    , allocated_( false )
+   , shared_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
 #endif
@@ -1948,6 +2020,7 @@ Value::Value( double value )
 Value::Value( const char *value )
    : type_( stringValue )
    , allocated_( true )
+   , shared_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
 #endif
@@ -1961,6 +2034,7 @@ Value::Value( const char *beginValue,
               const char *endValue )
    : type_( stringValue )
    , allocated_( true )
+   , shared_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
 #endif
@@ -1974,6 +2048,7 @@ Value::Value( const char *beginValue,
 Value::Value( const std::string &value )
    : type_( stringValue )
    , allocated_( true )
+   , shared_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
 #endif
@@ -1987,6 +2062,7 @@ Value::Value( const std::string &value )
 Value::Value( const StaticString &value )
    : type_( stringValue )
    , allocated_( false )
+   , shared_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
 #endif
@@ -2000,6 +2076,7 @@ Value::Value( const StaticString &value )
 Value::Value( const CppTL::ConstString &value )
    : type_( stringValue )
    , allocated_( true )
+   , shared_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
 #endif
@@ -2012,6 +2089,7 @@ Value::Value( const CppTL::ConstString &value )
 Value::Value( bool value )
    : type_( booleanValue )
    , allocated_( false )
+   , shared_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
 #endif
@@ -2024,6 +2102,7 @@ Value::Value( bool value )
 Value::Value( const Value &other )
    : type_( other.type_ )
    , allocated_( false )
+   , shared_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
 #endif
@@ -2050,7 +2129,14 @@ Value::Value( const Value &other )
 #ifndef JSON_VALUE_USE_INTERNAL_MAP
    case arrayValue:
    case objectValue:
-      value_.map_ = new ObjectValues( *other.value_.map_ );
+      if ( other.shared_  &&  !SharedObjectValues::from( other.value_.map_ )->unshareable_ )
+      {
+         value_.map_ = other.value_.map_;
+         ++SharedObjectValues::from( value_.map_ )->refCount_;
+         shared_ = 1;
+      }
+      else
+         value_.map_ = new ObjectValues( *other.value_.map_ );
       break;
 #else
    case arrayValue:
@@ -2076,6 +2162,25 @@ Value::Value( const Value &other )
 }
 
 
+#if JSON_HAS_RVALUE_REFERENCES
+Value::Value( Value &&other ) JSON_NOEXCEPT
+   : type_( other.type_ )
+   , allocated_( other.allocated_ )
+   , shared_( other.shared_ )
+# ifdef JSON_VALUE_USE_INTERNAL_MAP
+   , itemIsUsed_( 0 )
+#endif
+   , comments_( other.comments_ )
+{
+   value_ = other.value_;
+   other.type_ = nullValue;
+   other.allocated_ = false;
+   other.shared_ = 0;
+   other.comments_ = 0;
+}
+#endif
+
+
 Value::~Value()
 {
    switch ( type_ )
@@ -2093,7 +2198,7 @@ Value::~Value()
 #ifndef JSON_VALUE_USE_INTERNAL_MAP
    case arrayValue:
    case objectValue:
-      delete value_.map_;
+      releaseMap();
       break;
 #else
    case arrayValue:
@@ -2119,6 +2224,16 @@ Value::operator=( const Value &other )
    return *this;
 }
 
+#if JSON_HAS_RVALUE_REFERENCES
+Value &
+Value::operator=( Value &&other ) JSON_NOEXCEPT
+{
+   Value temp( std::move( other ) );
+   swap( temp );
+   return *this;
+}
+#endif
+
 void 
 Value::swap( Value &other )
 {
@@ -2129,6 +2244,9 @@ Value::swap( Value &other )
    int temp2 = allocated_;
    allocated_ = other.allocated_;
    other.allocated_ = temp2;
+   unsigned int temp3 = shared_;
+   shared_ = other.shared_;
+   other.shared_ = temp3;
 }
 
 ValueType 
@@ -2241,8 +2359,10 @@ Value::operator ==( const Value &other ) const
 #ifndef JSON_VALUE_USE_INTERNAL_MAP
    case arrayValue:
    case objectValue:
-      return value_.map_->size() == other.value_.map_->size()
-             && (*value_.map_) == (*other.value_.map_);
+      // Shared and interned subtrees compare by identity first.
+      return value_.map_ == other.value_.map_
+             || ( value_.map_->size() == other.value_.map_->size()
+                  && (*value_.map_) == (*other.value_.map_) );
 #else
    case arrayValue:
       return value_.array_->compare( *(other.value_.array_) ) == 0;
@@ -2599,6 +2719,7 @@ void
 Value::clear()
 {
    JSON_ASSERT( type_ == nullValue  ||  type_ == arrayValue  || type_ == objectValue );
+   detach();
 
    switch ( type_ )
    {
@@ -2626,6 +2747,7 @@ Value::resize( ArrayIndex newSize )
    JSON_ASSERT( type_ == nullValue  ||  type_ == arrayValue );
    if ( type_ == nullValue )
       *this = Value( arrayValue );
+   detach();
 #ifndef JSON_VALUE_USE_INTERNAL_MAP
    ArrayIndex oldSize = size();
    if ( newSize == 0 )
@@ -2652,14 +2774,14 @@ Value::operator[]( ArrayIndex index )
    JSON_ASSERT( type_ == nullValue  ||  type_ == arrayValue );
    if ( type_ == nullValue )
       *this = Value( arrayValue );
+   leak();
 #ifndef JSON_VALUE_USE_INTERNAL_MAP
    CZString key( index );
    ObjectValues::iterator it = value_.map_->lower_bound( key );
    if ( it != value_.map_->end()  &&  (*it).first == key )
       return (*it).second;
 
-   ObjectValues::value_type defaultValue( key, null );
-   it = value_.map_->insert( it, defaultValue );
+   it = value_.map_->insert( it, std::pair<CZString, Value>( key, null ) );
    return (*it).second;
 #else
    return value_.array_->resolveReference( index );
@@ -2716,6 +2838,7 @@ Value::resolveReference( const char *key,
    JSON_ASSERT( type_ == nullValue  ||  type_ == objectValue );
    if ( type_ == nullValue )
       *this = Value( objectValue );
+   leak();
 #ifndef JSON_VALUE_USE_INTERNAL_MAP
    CZString actualKey( key, isStatic ? CZString::noDuplication 
                                      : CZString::duplicateOnCopy );
@@ -2723,8 +2846,9 @@ Value::resolveReference( const char *key,
    if ( it != value_.map_->end()  &&  (*it).first == actualKey )
       return (*it).second;
 
-   ObjectValues::value_type defaultValue( actualKey, null );
-   it = value_.map_->insert( it, defaultValue );
+   // Building a mutable pair lets C++11 move the duplicated key into the
+   // node instead of duplicating it a second time.
+   it = value_.map_->insert( it, std::pair<CZString, Value>( actualKey, null ) );
    Value &value = (*it).second;
    return value;
 #else
@@ -2812,6 +2936,56 @@ Value::append( const Value &value )
 }
 
 
+#if JSON_HAS_RVALUE_REFERENCES
+Value &
+Value::append( Value &&value )
+{
+   JSON_ASSERT( type_ == nullValue  ||  type_ == arrayValue );
+   if ( type_ == nullValue )
+      *this = Value( arrayValue );
+   leak();
+#ifndef JSON_VALUE_USE_INTERNAL_MAP
+   // size() is one past the last index, so the new element always goes at
+   // the end of the map and the hint makes the insertion constant time.
+   ObjectValues::iterator it = value_.map_->insert( value_.map_->end(),
+      std::pair<CZString, Value>( CZString( size() ), std::move( value ) ) );
+   return (*it).second;
+#else
+   return (*this)[size()] = std::move( value );
+#endif
+}
+
+
+Value &
+Value::emplace( const char *key, Value &&value )
+{
+   JSON_ASSERT( type_ == nullValue  ||  type_ == objectValue );
+   if ( type_ == nullValue )
+      *this = Value( objectValue );
+   leak();
+#ifndef JSON_VALUE_USE_INTERNAL_MAP
+   CZString actualKey( key, CZString::duplicateOnCopy );
+   ObjectValues::iterator it = value_.map_->lower_bound( actualKey );
+   if ( it != value_.map_->end()  &&  (*it).first == actualKey )
+      return (*it).second = std::move( value );
+
+   it = value_.map_->insert( it, 
+      std::pair<CZString, Value>( std::move( actualKey ), std::move( value ) ) );
+   return (*it).second;
+#else
+   return resolveReference( key, false ) = std::move( value );
+#endif
+}
+
+
+Value &
+Value::emplace( const std::string &key, Value &&value )
+{
+   return emplace( key.c_str(), std::move( value ) );
+}
+#endif
+
+
 Value 
 Value::get( const char *key, 
             const Value &defaultValue ) const
@@ -2834,12 +3008,15 @@ Value::removeMember( const char* key )
    JSON_ASSERT( type_ == nullValue  ||  type_ == objectValue );
    if ( type_ == nullValue )
       return null;
+   detach();
 #ifndef JSON_VALUE_USE_INTERNAL_MAP
    CZString actualKey( key, CZString::noDuplication );
    ObjectValues::iterator it = value_.map_->find( actualKey );
    if ( it == value_.map_->end() )
       return null;
-   Value old(it->second);
+   // The member is erased right after, so hand its content (and comments)
+   // over instead of copying the subtree.
+   Value old( std::move( it->second ) );
    value_.map_->erase(it);
    return old;
 #else
@@ -3210,6 +3387,7 @@ Value::end() const
 Value::iterator 
 Value::begin()
 {
+   leak();
    switch ( type_ )
    {
 #ifdef JSON_VALUE_USE_INTERNAL_MAP
@@ -3245,6 +3423,7 @@ Value::begin()
 Value::iterator 
 Value::end()
 {
+   leak();
    switch ( type_ )
    {
 #ifdef JSON_VALUE_USE_INTERNAL_MAP
@@ -3278,6 +3457,221 @@ Value::end()
 }
 
 
+void 
+Value::releaseMap()
+{
+#ifndef JSON_VALUE_USE_INTERNAL_MAP
+   if ( !shared_ )
+      delete value_.map_;
+   else
+   {
+      SharedObjectValues *shared = SharedObjectValues::from( value_.map_ );
+      if ( --shared->refCount_ == 0 )
+         delete shared;
+   }
+#endif
+}
+
+
+/* Called before any access that may modify a shared array or object: gives
+ * this value its own copy of the elements if they are still referenced by
+ * another value. The elements themselves are copied cheaply when they are
+ * shared too. The cached hash is dropped since the content may change.
+ */
+void 
+Value::detach()
+{
+#ifndef JSON_VALUE_USE_INTERNAL_MAP
+   if ( !shared_ )
+      return;
+   SharedObjectValues *shared = SharedObjectValues::from( value_.map_ );
+   if ( shared->refCount_ > 1 )
+   {
+      SharedObjectValues *copy = new SharedObjectValues();
+      copy->values_ = shared->values_;
+      --shared->refCount_;
+      shared = copy;
+      value_.map_ = &copy->values_;
+   }
+   shared->hasHash_ = false;
+#endif
+}
+
+
+/* Called by the non-const members that return a reference or an iterator to
+ * an element: detaches, then marks the storage unshareable so that copies
+ * made while the reference may still be in use clone the elements. Going
+ * through a non-const accessor at every level is the only way to reach an
+ * element, so each ancestor of a modified element has dropped its cached
+ * hash by then.
+ */
+void 
+Value::leak()
+{
+#ifndef JSON_VALUE_USE_INTERNAL_MAP
+   detach();
+   if ( shared_ )
+      SharedObjectValues::from( value_.map_ )->unshareable_ = true;
+#endif
+}
+
+
+/// Moves the elements of this array or object into reference counted storage.
+void 
+Value::makeShared()
+{
+#ifndef JSON_VALUE_USE_INTERNAL_MAP
+   if ( shared_ )
+      return;
+   SharedObjectValues *shared = new SharedObjectValues();
+   shared->values_.swap( *value_.map_ );
+   delete value_.map_;
+   value_.map_ = &shared->values_;
+   shared_ = 1;
+#endif
+}
+
+
+void 
+Value::share()
+{
+#ifndef JSON_VALUE_USE_INTERNAL_MAP
+   if ( type_ != arrayValue  &&  type_ != objectValue )
+      return;
+   // Switching the storage of an element does not change its content, so
+   // this is done in place even if the elements are referenced elsewhere.
+   for ( ObjectValues::iterator it = value_.map_->begin(); it != value_.map_->end(); ++it )
+      it->second.share();
+   makeShared();
+   SharedObjectValues::from( value_.map_ )->unshareable_ = false;
+#endif
+}
+
+
+bool 
+Value::isShared() const
+{
+   return shared_ != 0;
+}
+
+
+std::size_t 
+Value::hash() const
+{
+   std::size_t hash = std::size_t( type_ );
+   switch ( type_ )
+   {
+   case nullValue:
+      break;
+   case intValue:
+   case uintValue:
+      hash = combineHash( hash, std::size_t( value_.uint_ ) );
+      hash = combineHash( hash, std::size_t( value_.uint_ >> 16 >> 16 ) );
+      break;
+   case realValue:
+      {
+         // 0.0 and -0.0 compare equal.
+         double real = value_.real_ == 0.0 ? 0.0 : value_.real_;
+         UInt64 bits;
+         memcpy( &bits, &real, sizeof(bits) );
+         hash = combineHash( hash, std::size_t( bits ) );
+         hash = combineHash( hash, std::size_t( bits >> 16 >> 16 ) );
+      }
+      break;
+   case booleanValue:
+      hash = combineHash( hash, value_.bool_ ? 1 : 0 );
+      break;
+   case stringValue:
+      if ( value_.string_ )
+         hash = combineHash( hash, hashString( value_.string_ ) );
+      break;
+#ifndef JSON_VALUE_USE_INTERNAL_MAP
+   case arrayValue:
+   case objectValue:
+      {
+         SharedObjectValues *shared = shared_ ? SharedObjectValues::from( value_.map_ ) : 0;
+         if ( shared  &&  shared->hasHash_ )
+            return shared->hash_;
+         for ( ObjectValues::const_iterator it = value_.map_->begin(); it != value_.map_->end(); ++it )
+         {
+            const char *key = it->first.c_str();
+            hash = combineHash( hash, key ? hashString( key ) : std::size_t( it->first.index() ) );
+            hash = combineHash( hash, it->second.hash() );
+         }
+      }
+      break;
+#else
+   case arrayValue:
+   case objectValue:
+      hash = combineHash( hash, size() );
+      break;
+#endif
+   default:
+      JSON_ASSERT_UNREACHABLE;
+   }
+   return hash;
+}
+
+
+// class ValueInternTable
+// //////////////////////////////////////////////////////////////////
+
+void 
+ValueInternTable::intern( Value &root )
+{
+#ifndef JSON_VALUE_USE_INTERNAL_MAP
+   if ( root.type_ != arrayValue  &&  root.type_ != objectValue )
+      return;
+   if ( root.shared_  &&  SharedObjectValues::from( root.value_.map_ )->hasHash_ )
+   {
+      // Already merged by a previous call.
+      std::pair<Entries::iterator, Entries::iterator> range = entries_.equal_range( root.hash() );
+      for ( Entries::iterator it = range.first; it != range.second; ++it )
+         if ( it->second.value_.map_ == root.value_.map_ )
+            return;
+   }
+
+   // Walks the elements directly: begin() would mark the storage unshareable.
+   for ( Value::ObjectValues::iterator it = root.value_.map_->begin(); it != root.value_.map_->end(); ++it )
+      intern( it->second );
+   root.makeShared();
+
+   // The hash is cached here rather than in the const Value::hash(), so that
+   // concurrent readers never write to a value.
+   SharedObjectValues *shared = SharedObjectValues::from( root.value_.map_ );
+   shared->hasHash_ = false;
+   std::size_t hash = root.hash();
+   shared->hash_ = hash;
+   shared->hasHash_ = true;
+   shared->unshareable_ = false;
+   std::pair<Entries::iterator, Entries::iterator> range = entries_.equal_range( hash );
+   for ( Entries::iterator it = range.first; it != range.second; ++it )
+   {
+      if ( it->second == root )
+      {
+         root = it->second;
+         return;
+      }
+   }
+   entries_.insert( range.second, Entries::value_type( hash, root ) );
+#endif
+}
+
+
+std::size_t 
+ValueInternTable::size() const
+{
+   return entries_.size();
+}
+
+
+void 
+ValueInternTable::clear()
+{
+   entries_.clear();
+}
+
+
 // class PathArgument
 // //////////////////////////////////////////////////////////////////
 
@@ -3492,6 +3886,241 @@ Path::make( Value &root ) const
 }
 
 
+// class CompiledPath
+// //////////////////////////////////////////////////////////////////
+
+CompiledPath::CompiledPath()
+   : valid_( false )
+{
+}
+
+
+CompiledPath::CompiledPath( const std::string &path,
+                            const PathArgument &a1,
+                            const PathArgument &a2,
+                            const PathArgument &a3,
+                            const PathArgument &a4,
+                            const PathArgument &a5 )
+   : valid_( true )
+{
+   std::vector<const PathArgument *> in;
+   in.push_back( &a1 );
+   in.push_back( &a2 );
+   in.push_back( &a3 );
+   in.push_back( &a4 );
+   in.push_back( &a5 );
+   compile( path, in );
+   if ( !valid_ )
+      steps_.clear();
+}
+
+
+static inline bool 
+readArrayIndex( const char *&current, 
+                const char *end, 
+                ArrayIndex &index )
+{
+   const char *begin = current;
+   index = 0;
+   for ( ; current != end  &&  *current >= '0'  &&  *current <= '9'; ++current )
+   {
+      ArrayIndex digit = ArrayIndex(*current - '0');
+      // Stop before exceeding Value::maxUInt; the caller then rejects the
+      // path on the unread digit.
+      if ( index > (Value::maxUInt - digit) / 10 )
+         break;
+      index = index * 10 + digit;
+   }
+   return current != begin;
+}
+
+
+void 
+CompiledPath::compile( const std::string &path,
+                       const std::vector<const PathArgument *> &in )
+{
+   const char *current = path.c_str();
+   const char *end = current + path.length();
+   std::vector<const PathArgument *>::const_iterator itInArg = in.begin();
+   while ( current != end  &&  valid_ )
+   {
+      Step step;
+      step.begin_ = 0;
+      step.end_ = ArrayIndex(-1);
+      if ( *current == '[' )
+      {
+         ++current;
+         if ( current != end  &&  *current == '%' )
+         {
+            ++current;
+            valid_ = itInArg != in.end()  &&  
+                     (*itInArg)->kind_ == PathArgument::kindIndex;
+            if ( valid_ )
+               step.begin_ = (*itInArg++)->index_;
+            step.kind_ = Step::index;
+         }
+         else if ( current != end  &&  *current == '*' )
+         {
+            ++current;
+            step.kind_ = Step::slice;
+         }
+         else
+         {
+            ArrayIndex index;
+            bool hasBegin = readArrayIndex( current, end, index );
+            if ( current != end  &&  *current == ':' )
+            {
+               ++current;
+               step.kind_ = Step::slice;
+               if ( hasBegin )
+                  step.begin_ = index;
+               if ( readArrayIndex( current, end, index ) )
+                  step.end_ = index;
+            }
+            else
+            {
+               valid_ = hasBegin;
+               step.kind_ = Step::index;
+               step.begin_ = index;
+            }
+         }
+         if ( current == end  ||  *current++ != ']' )
+            valid_ = false;
+      }
+      else if ( *current == '%' )
+      {
+         ++current;
+         valid_ = itInArg != in.end()  &&  
+                  (*itInArg)->kind_ == PathArgument::kindKey;
+         if ( valid_ )
+            step.key_ = (*itInArg++)->key_;
+         step.kind_ = Step::member;
+      }
+      else if ( *current == '.' )
+      {
+         ++current;
+         if ( current == end  ||  *current != '*' )
+            continue;
+         ++current;
+         step.kind_ = Step::anyMember;
+      }
+      else
+      {
+         const char *beginName = current;
+         while ( current != end  &&  !strchr( "[.", *current ) )
+            ++current;
+         step.kind_ = Step::member;
+         step.key_.assign( beginName, current );
+      }
+      steps_.push_back( step );
+   }
+}
+
+
+bool 
+CompiledPath::isValid() const
+{
+   return valid_;
+}
+
+
+bool 
+CompiledPath::resolveStep( const Value &node,
+                           Steps::size_type step,
+                           Nodes &nodes,
+                           bool firstOnly ) const
+{
+   const Value *current = &node;
+   // Follow single-node steps iteratively; only wildcards and slices branch.
+   for ( ; step != steps_.size(); ++step )
+   {
+      const Step &arg = steps_[step];
+      switch ( arg.kind_ )
+      {
+      case Step::member:
+         if ( !current->isObject() )
+            return false;
+         current = &((*current)[arg.key_]);
+         if ( current == &Value::null )
+            return false;
+         break;
+      case Step::index:
+         if ( !current->isArray()  ||  !current->isValidIndex( arg.begin_ ) )
+            return false;
+         current = &((*current)[arg.begin_]);
+         break;
+      case Step::anyMember:
+         if ( current->isObject() )
+         {
+            for ( Value::const_iterator it = current->begin(); it != current->end(); ++it )
+            {
+               if ( resolveStep( *it, step + 1, nodes, firstOnly ) )
+                  return true;
+            }
+         }
+         return false;
+      case Step::slice:
+         if ( current->isArray() )
+         {
+            ArrayIndex end = arg.end_ < current->size() ? arg.end_ : current->size();
+            for ( ArrayIndex index = arg.begin_; index < end; ++index )
+            {
+               if ( resolveStep( (*current)[index], step + 1, nodes, firstOnly ) )
+                  return true;
+            }
+         }
+         return false;
+      }
+   }
+   nodes.push_back( current );
+   return firstOnly;
+}
+
+
+void 
+CompiledPath::resolve( const Value &root, Nodes &nodes ) const
+{
+   if ( valid_ )
+      resolveStep( root, 0, nodes, false );
+}
+
+
+const Value &
+CompiledPath::resolveFirst( const Value &root ) const
+{
+   Nodes nodes;
+   if ( valid_ )
+      resolveStep( root, 0, nodes, true );
+   return nodes.empty() ? Value::null : *nodes.front();
+}
+
+
+void 
+CompiledPath::resolveAll( const Documents &documents,
+                          std::vector<Nodes> &results ) const
+{
+   results.resize( documents.size() );
+   for ( Documents::size_type index = 0; index < documents.size(); ++index )
+   {
+      results[index].clear();
+      resolve( *documents[index], results[index] );
+   }
+}
+
+
+// class PathCache
+// //////////////////////////////////////////////////////////////////
+
+const CompiledPath &
+PathCache::get( const std::string &path )
+{
+   std::map<std::string, CompiledPath>::iterator it = paths_.lower_bound( path );
+   if ( it == paths_.end()  ||  it->first != path )
+      it = paths_.insert( it, std::make_pair( path, CompiledPath( path ) ) );
+   return it->second;
+}
+
+
 } // namespace Json
 
 // //////////////////////////////////////////////////////////////////////
@@ -3522,6 +4151,14 @@ Path::make( Value &root ) const
 #include <string.h>
 #include <sstream>
 #include <iomanip>
+#if JSON_HAS_STD_THREAD
+# include <atomic>
+# include <thread>
+#endif
+#if defined(__SSE2__)  ||  defined(_M_X64)  ||  ( defined(_M_IX86_FP)  &&  _M_IX86_FP >= 2 )
+# include <emmintrin.h>
+# define JSON_WRITER_USE_SSE2 1
+#endif
 
 #if _MSC_VER >= 1400 // VC++ 8.0
 #pragma warning( disable : 4996 )   // disable warning about strdup being deprecated.
@@ -3529,17 +4166,6 @@ Path::make( Value &root ) const
 
 namespace Json {
 
-static bool containsControlCharacter( const char* str )
-{
-   while ( *str ) 
-   {
-      if ( isControlCharacter( *(str++) ) )
-         return true;
-   }
-   return false;
-}
-
-
 std::string valueToString( LargestInt value )
 {
    UIntToStringBuffer buffer;
@@ -3580,16 +4206,28 @@ std::string valueToString( UInt value )
 #endif // # if defined(JSON_HAS_INT64)
 
 
-std::string valueToString( double value )
+enum {
+   /// Constant that specify the size of the buffer that must be passed to formatNumber().
+   numberBufferSize = 32
+};
+
+// Defines a char buffer for use with formatNumber().
+typedef char NumberBuffer[numberBufferSize];
+
+
+/** Writes the zero-terminated text of valueToString( double ) into buffer.
+ * @param buffer Must have at least numberBufferSize chars.
+ */
+static void 
+doubleToChars( double value, char *buffer )
 {
-   char buffer[32];
 #if defined(_MSC_VER) && defined(__STDC_SECURE_LIB__) // Use secure version with visual studio 2005 to avoid warning. 
-   sprintf_s(buffer, sizeof(buffer), "%#.16g", value); 
+   sprintf_s(buffer, numberBufferSize, "%#.16g", value); 
 #else	
    sprintf(buffer, "%#.16g", value); 
 #endif
    char* ch = buffer + strlen(buffer) - 1;
-   if (*ch != '0') return buffer; // nothing to truncate, so save time
+   if (*ch != '0') return; // nothing to truncate, so save time
    while(ch > buffer && *ch == '0'){
      --ch;
    }
@@ -3611,82 +4249,147 @@ std::string valueToString( double value )
      case '.':
        // Truncate zeroes to save bytes in output, but keep one.
        *(last_nonzero+2) = '\0';
-       return buffer;
+       return;
      default:
-       return buffer;
+       return;
      }
    }
+}
+
+
+std::string valueToString( double value )
+{
+   NumberBuffer buffer;
+   doubleToChars( value, buffer );
    return buffer;
 }
 
 
+/** Formats an intValue, uintValue or realValue exactly like valueToString() does,
+ * but without building a std::string, so writers can append it straight to
+ * their document.
+ * @param length Receives the length of the text.
+ * @return Pointer on the first char of the text, somewhere inside buffer.
+ */
+static const char *
+formatNumber( const Value &value, 
+              NumberBuffer buffer, 
+              unsigned int &length )
+{
+   char *current = buffer + numberBufferSize;
+   switch ( value.type() )
+   {
+   case intValue:
+      {
+         LargestInt i = value.asLargestInt();
+         bool isNegative = i < 0;
+         uintToString( LargestUInt( isNegative ? -i : i ), current );
+         if ( isNegative )
+            *--current = '-';
+      }
+      break;
+   case uintValue:
+      uintToString( value.asLargestUInt(), current );
+      break;
+   default:
+      doubleToChars( value.asDouble(), buffer );
+      length = (unsigned int)strlen( buffer );
+      return buffer;
+   }
+   // uintToString() also wrote the terminating zero.
+   length = (unsigned int)( buffer + numberBufferSize - current - 1 );
+   return current;
+}
+
+
 std::string valueToString( bool value )
 {
    return value ? "true" : "false";
 }
 
-std::string valueToQuotedString( const char *value )
+/* Escape sequence of each char: 0 if the char is copied as is, the char
+ * following the backslash otherwise, 'u' meaning \u00XX. Forward slashes are
+ * *not* escaped: even though \/ is a legal escape in JSON, a bare slash is
+ * also legal. (blep notes: escaping \/ may be useful in javascript to avoid
+ * the </ sequence; a flag could enable that compatibility mode.)
+ */
+static const char escapeTable[256] = {
+   'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',
+   'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+   0,   0,   '"', 0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   '\\',0,   0,   0
+   // Remaining chars, including all non ASCII UTF-8 bytes, are zero.
+};
+
+
+/// Returns the first char of [begin, end) that must be escaped, or end.
+static inline const char *
+findEscapedChar( const char *begin, 
+                 const char *end )
 {
-   if (value == NULL)
-      return "";
-   // Not sure how to handle unicode...
-   if (strpbrk(value, "\"\\\b\f\n\r\t") == NULL && !containsControlCharacter( value ))
-      return std::string("\"") + value + "\"";
-   // We have to walk value and escape any special characters.
-   // Appending to std::string is not efficient, but this should be rare.
-   // (Note: forward slashes are *not* rare, but I am not escaping them.)
-   std::string::size_type maxsize = strlen(value)*2 + 3; // allescaped+quotes+NULL
-   std::string result;
-   result.reserve(maxsize); // to avoid lots of mallocs
-   result += "\"";
-   for (const char* c=value; *c != 0; ++c)
+#if defined(JSON_WRITER_USE_SSE2)
+   // Flags '"', '\\' and every byte <= 0x1F, 16 chars at a time.
+   const __m128i quote = _mm_set1_epi8( '"' );
+   const __m128i backslash = _mm_set1_epi8( '\\' );
+   const __m128i lastControl = _mm_set1_epi8( 0x1F );
+   for ( ; end - begin >= 16; begin += 16 )
    {
-      switch(*c)
+      __m128i chars = _mm_loadu_si128( reinterpret_cast<const __m128i *>( begin ) );
+      __m128i escaped = _mm_or_si128( 
+         _mm_or_si128( _mm_cmpeq_epi8( chars, quote ), _mm_cmpeq_epi8( chars, backslash ) ),
+         _mm_cmpeq_epi8( _mm_max_epu8( chars, lastControl ), lastControl ) );
+      int mask = _mm_movemask_epi8( escaped );
+      if ( mask != 0 )
       {
-         case '\"':
-            result += "\\\"";
-            break;
-         case '\\':
-            result += "\\\\";
-            break;
-         case '\b':
-            result += "\\b";
-            break;
-         case '\f':
-            result += "\\f";
-            break;
-         case '\n':
-            result += "\\n";
-            break;
-         case '\r':
-            result += "\\r";
-            break;
-         case '\t':
-            result += "\\t";
-            break;
-         //case '/':
-            // Even though \/ is considered a legal escape in JSON, a bare
-            // slash is also legal, so I see no reason to escape it.
-            // (I hope I am not misunderstanding something.
-            // blep notes: actually escaping \/ may be useful in javascript to avoid </ 
-            // sequence.
-            // Should add a flag to allow this compatibility mode and prevent this 
-            // sequence from occurring.
-         default:
-            if ( isControlCharacter( *c ) )
-            {
-               std::ostringstream oss;
-               oss << "\\u" << std::hex << std::uppercase << std::setfill('0') << std::setw(4) << static_cast<int>(*c);
-               result += oss.str();
-            }
-            else
-            {
-               result += *c;
-            }
-            break;
+# if defined(_MSC_VER)
+         unsigned long index;
+         _BitScanForward( &index, (unsigned long)mask );
+         return begin + index;
+# else
+         return begin + __builtin_ctz( (unsigned int)mask );
+# endif
       }
    }
-   result += "\"";
+#endif
+   while ( begin != end  &&  !escapeTable[(unsigned char)*begin] )
+      ++begin;
+   return begin;
+}
+
+
+/// Appends the JSON string literal of [begin, end) to document.
+static void 
+appendQuotedString( std::string &document, 
+                    const char *begin, 
+                    const char *end )
+{
+   static const char hexDigits[] = "0123456789ABCDEF";
+   document += '"';
+   for (;;)
+   {
+      const char *escaped = findEscapedChar( begin, end );
+      document.append( begin, escaped );
+      if ( escaped == end )
+         break;
+      unsigned char c = (unsigned char)*escaped;
+      char sequence[6] = { '\\', escapeTable[c], '0', '0', hexDigits[c >> 4], hexDigits[c & 0xF] };
+      document.append( sequence, sequence[1] == 'u' ? 6 : 2 );
+      begin = escaped + 1;
+   }
+   document += '"';
+}
+
+
+std::string valueToQuotedString( const char *value )
+{
+   if (value == NULL)
+      return "";
+   std::string::size_type length = strlen(value);
+   std::string result;
+   result.reserve(length + 2);
+   appendQuotedString( result, value, value + length );
    return result;
 }
 
@@ -3749,7 +4452,8 @@ FastWriter::writeValue( const Value &value )
       document_ += valueToString( value.asDouble() );
       break;
    case stringValue:
-      document_ += valueToQuotedString( value.asCString() );
+      if ( const char *str = value.asCString() )
+         appendQuotedString( document_, str, str + strlen( str ) );
       break;
    case booleanValue:
       document_ += valueToString( value.asBool() );
@@ -3778,7 +4482,7 @@ FastWriter::writeValue( const Value &value )
             const std::string &name = *it;
             if ( it != members.begin() )
                document_ += ",";
-            document_ += valueToQuotedString( name.c_str() );
+            appendQuotedString( document_, name.data(), name.data() + name.size() );
             document_ += yamlCompatiblityEnabled_ ? ": " 
                                                   : ":";
             writeValue( value[name] );
@@ -3833,7 +4537,10 @@ StyledWriter::writeValue( const Value &value )
       pushValue( valueToString( value.asDouble() ) );
       break;
    case stringValue:
-      pushValue( valueToQuotedString( value.asCString() ) );
+      if ( addChildValues_ )
+         pushValue( valueToQuotedString( value.asCString() ) );
+      else if ( const char *str = value.asCString() )
+         appendQuotedString( document_, str, str + strlen( str ) );
       break;
    case booleanValue:
       pushValue( valueToString( value.asBool() ) );
@@ -3856,7 +4563,8 @@ StyledWriter::writeValue( const Value &value )
                const std::string &name = *it;
                const Value &childValue = value[name];
                writeCommentBeforeValue( childValue );
-               writeWithIndent( valueToQuotedString( name.c_str() ) );
+               writeIndent();
+               appendQuotedString( document_, name.data(), name.data() + name.size() );
                document_ += " : ";
                writeValue( childValue );
                if ( ++it == members.end() )
@@ -3882,6 +4590,8 @@ StyledWriter::writeArrayValue( const Value &value )
    unsigned size = value.size();
    if ( size == 0 )
       pushValue( "[]" );
+   else if ( !addChildValues_  &&  isNumericArray( value ) )
+      writeNumericArrayValue( value );
    else
    {
       bool isArrayMultiLine = isMultineArray( value );
@@ -3929,6 +4639,79 @@ StyledWriter::writeArrayValue( const Value &value )
 }
 
 
+bool 
+StyledWriter::isNumericArray( const Value &value )
+{
+   // Iterating skips the holes of a sparse array; those are written as null,
+   // so such an array is not numeric.
+   unsigned count = 0;
+   for ( Value::const_iterator it = value.begin(); it != value.end(); ++it, ++count )
+   {
+      const Value &childValue = *it;
+      ValueType type = childValue.type();
+      if ( ( type != intValue  &&  type != uintValue  &&  type != realValue )  ||
+           hasCommentForValue( childValue ) )
+         return false;
+   }
+   return count == value.size();
+}
+
+
+/* Fast path for long arrays of numbers, such as vertex data.
+ * Numbers are formatted straight into document_ without going through
+ * childValues_. An array that fits within the right margin is written on a
+ * single line exactly as writeArrayValue() would; otherwise as many numbers as
+ * fit in the margin are packed on each line instead of one per line.
+ */
+void 
+StyledWriter::writeNumericArrayValue( const Value &value )
+{
+   unsigned size = value.size();
+   NumberBuffer buffer;
+   unsigned int length;
+   if ( int(size*3) < rightMargin_ )
+   {
+      std::string::size_type start = document_.size();
+      document_ += "[ ";
+      for ( Value::const_iterator it = value.begin(); it != value.end(); ++it )
+      {
+         if ( it != value.begin() )
+            document_ += ", ";
+         const char *text = formatNumber( *it, buffer, length );
+         document_.append( text, length );
+      }
+      document_ += " ]";
+      if ( int( document_.size() - start ) < rightMargin_ )
+         return;
+      document_.resize( start );
+   }
+
+   writeWithIndent( "[" );
+   indent();
+   writeIndent();
+   std::string::size_type lineStart = document_.size() - indentString_.size();
+   for ( Value::const_iterator it = value.begin(); it != value.end(); ++it )
+   {
+      const char *text = formatNumber( *it, buffer, length );
+      if ( it != value.begin() )
+      {
+         document_ += ',';
+         if ( int( document_.size() - lineStart + 1 + length ) > rightMargin_ )
+         {
+            document_ += '\n';
+            lineStart = document_.size();
+            document_ += indentString_;
+         }
+         else
+            document_ += ' ';
+      }
+      document_.append( text, length );
+   }
+   unindent();
+   writeWithIndent( "]" );
+}
+
+
 bool 
 StyledWriter::isMultineArray( const Value &value )
 {
@@ -4042,6 +4825,23 @@ StyledWriter::hasCommentForValue( const Value &value )
 }
 
 
+/* Formats value as if it was the member of an object indented by indentString,
+ * i.e. right after its "name : ". The returned document starts with the space
+ * that tells writeIndent() the value is already indented; the text of the
+ * value follows it.
+ */
+const std::string &
+StyledWriter::writeMemberValue( const Value &value, 
+                                const std::string &indentString )
+{
+   document_ = " ";
+   addChildValues_ = false;
+   indentString_ = indentString;
+   writeValue( value );
+   return document_;
+}
+
+
 std::string 
 StyledWriter::normalizeEOL( const std::string &text )
 {
@@ -4066,6 +4866,116 @@ StyledWriter::normalizeEOL( const std::string &text )
 }
 
 
+// Class ParallelStyledWriter
+// //////////////////////////////////////////////////////////////////
+
+ParallelStyledWriter::ParallelStyledWriter( unsigned int threadCount )
+   : threadCount_( threadCount )
+{
+#if JSON_HAS_STD_THREAD
+   if ( threadCount_ == 0 )
+      threadCount_ = std::thread::hardware_concurrency();
+#endif
+}
+
+
+std::string 
+ParallelStyledWriter::write( const Value &root )
+{
+   StyledWriter writer;
+#if JSON_HAS_STD_THREAD
+   if ( threadCount_ < 2  ||  !root.isObject()  ||  root.empty() )
+      return writer.write( root );
+
+   Value::Members members( root.getMemberNames() );
+   std::vector<unsigned int> jobs;
+   for ( unsigned int index = 0; index < members.size(); ++index )
+   {
+      const Value &childValue = root[members[index]];
+      if ( ( childValue.isArray()  ||  childValue.isObject() )  &&  !childValue.empty() )
+         jobs.push_back( index );
+   }
+   if ( jobs.size() < 2 )
+      return writer.write( root );
+
+   // Members of the root object are indented by one level.
+   const std::string memberIndent( writer.indentSize_, ' ' );
+   std::vector<std::string> rendered( members.size() );
+   std::atomic<unsigned int> nextJob( 0 );
+   struct Worker
+   {
+      static void run( const Value &root, 
+                       const Value::Members &members, 
+                       const std::vector<unsigned int> &jobs, 
+                       const std::string &memberIndent, 
+                       std::vector<std::string> &rendered, 
+                       std::atomic<unsigned int> &nextJob )
+      {
+         StyledWriter writer;
+         for ( unsigned int job = nextJob++; job < jobs.size(); job = nextJob++ )
+         {
+            unsigned int index = jobs[job];
+            rendered[index] = writer.writeMemberValue( root[members[index]], memberIndent );
+         }
+      }
+   };
+   unsigned int threadCount = threadCount_ < jobs.size() ? threadCount_ : unsigned(jobs.size());
+   std::vector<std::thread> threads;
+   threads.reserve( threadCount - 1 );
+   for ( unsigned int thread = 1; thread < threadCount; ++thread )
+      threads.push_back( std::thread( &Worker::run, std::cref( root ), std::cref( members ), 
+                                      std::cref( jobs ), std::cref( memberIndent ), 
+                                      std::ref( rendered ), std::ref( nextJob ) ) );
+   Worker::run( root, members, jobs, memberIndent, rendered, nextJob );
+   for ( unsigned int thread = 0; thread < threads.size(); ++thread )
+      threads[thread].join();
+
+   // Stitch the buffers together following StyledWriter::write() and the
+   // objectValue case of StyledWriter::writeValue().
+   std::string::size_type length = 0;
+   for ( unsigned int index = 0; index < rendered.size(); ++index )
+      length += rendered[index].size();
+   writer.document_.reserve( length + 64 * members.size() );
+   writer.document_ = "";
+   writer.addChildValues_ = false;
+   writer.indentString_ = "";
+   writer.writeCommentBeforeValue( root );
+   writer.writeWithIndent( "{" );
+   writer.indent();
+   for ( unsigned int index = 0; ; )
+   {
+      const std::string &name = members[index];
+      const Value &childValue = root[name];
+      writer.writeCommentBeforeValue( childValue );
+      writer.writeIndent();
+      appendQuotedString( writer.document_, name.data(), name.data() + name.size() );
+      writer.document_ += " : ";
+      if ( rendered[index].empty() )
+         writer.writeValue( childValue );
+      else
+      {
+         writer.document_.append( rendered[index], 1, std::string::npos );
+         std::string().swap( rendered[index] );
+      }
+      if ( ++index == members.size() )
+      {
+         writer.writeCommentAfterValueOnSameLine( childValue );
+         break;
+      }
+      writer.document_ += ",";
+      writer.writeCommentAfterValueOnSameLine( childValue );
+   }
+   writer.unindent();
+   writer.writeWithIndent( "}" );
+   writer.writeCommentAfterValueOnSameLine( root );
+   writer.document_ += "\n";
+   return writer.document_;
+#else
+   return writer.write( root );
+#endif
+}
+
+
 // Class StyledStreamWriter
 // //////////////////////////////////////////////////////////////////
 
@@ -0,0 +1,435 @@
+#include <iostream>
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <cmath>
+
+#include "lod.h"
+#include "buffergeometry.h"
+#include "parallel.h"
+#include "allocationcounter.h"
+
+// Triangles per candidate evaluation job.
+static const size_t trianglesPerJob = 1 << 15;
+
+namespace {
+
+// Symmetric 4x4 quadric: p^T A p + 2 b.p + c, over the total plane weight w.
+struct Quadric {
+	Quadric() : a00(0), a01(0), a02(0), a11(0), a12(0), a22(0), b0(0), b1(0), b2(0), c(0), w(0) {}
+
+	double a00, a01, a02, a11, a12, a22;
+	double b0, b1, b2;
+	double c;
+	double w;
+
+	void addPlane(double nx, double ny, double nz, double d, double weight) {
+		a00 += weight * nx * nx; a01 += weight * nx * ny; a02 += weight * nx * nz;
+		a11 += weight * ny * ny; a12 += weight * ny * nz; a22 += weight * nz * nz;
+		b0 += weight * nx * d; b1 += weight * ny * d; b2 += weight * nz * d;
+		c += weight * d * d;
+		w += weight;
+	}
+
+	void add(const Quadric& q) {
+		a00 += q.a00; a01 += q.a01; a02 += q.a02; a11 += q.a11; a12 += q.a12; a22 += q.a22;
+		b0 += q.b0; b1 += q.b1; b2 += q.b2; c += q.c;
+		w += q.w;
+	}
+
+	// Weighted mean squared distance from p to the planes, so the cost is in length units squared
+	// whatever the triangle areas.
+	double evaluate(const aiVector3D& p) const {
+		double x = p.x, y = p.y, z = p.z;
+		double result = a00 * x * x + a11 * y * y + a22 * z * z
+			+ 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+			+ 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+		return result > 0.0 && w > 0.0 ? result / w : 0.0;
+	}
+};
+
+struct Collapse {
+	unsigned int from;
+	unsigned int to;
+	double cost;
+
+	bool operator<(const Collapse& other) const { return cost < other.cost; }
+};
+
+// Immutable per-vertex data shared by every pass.
+struct Simplifier {
+	const Mesh* mesh;
+	std::vector<unsigned int> position;      // vertex -> welded position id
+	std::vector<bool> locked;                // seams, borders, non-manifold
+	std::vector<unsigned short> skinIndex;
+	std::vector<float> skinWeight;
+	float skinWeightTolerance;
+	std::vector<Quadric> quadrics;           // per welded position
+};
+
+}
+
+static float influenceWeight(const unsigned short* indices, const float* weights, unsigned short bone) {
+	for (unsigned int i = 0; i < influencesPerVertex; ++i) {
+		if (weights[i] > 0.0f && indices[i] == bone) {
+			return weights[i];
+		}
+	}
+	return 0.0f;
+}
+
+// Sum of absolute weight differences over the union of both vertices' bones.
+static bool skinCompatible(const Simplifier& s, unsigned int a, unsigned int b) {
+	if (s.skinWeight.empty()) {
+		return true;
+	}
+
+	const unsigned short* ia = &s.skinIndex[a * influencesPerVertex];
+	const unsigned short* ib = &s.skinIndex[b * influencesPerVertex];
+	const float* wa = &s.skinWeight[a * influencesPerVertex];
+	const float* wb = &s.skinWeight[b * influencesPerVertex];
+	float difference = 0.0f;
+	for (unsigned int i = 0; i < influencesPerVertex; ++i) {
+		if (wa[i] > 0.0f) {
+			difference += std::fabs(wa[i] - influenceWeight(ib, wb, ia[i]));
+		}
+		if (wb[i] > 0.0f && influenceWeight(ia, wa, ib[i]) == 0.0f) {
+			difference += wb[i];
+		}
+	}
+	return difference <= s.skinWeightTolerance;
+}
+
+static void evaluateCandidates(const Simplifier& s, const std::vector<unsigned int>& indices,
+	size_t firstTriangle, size_t lastTriangle, std::vector<Collapse>& out) {
+
+	for (size_t t = firstTriangle; t < lastTriangle; ++t) {
+		for (unsigned int e = 0; e < 3; ++e) {
+			unsigned int a = indices[t * 3 + e];
+			unsigned int b = indices[t * 3 + (e + 1) % 3];
+			for (unsigned int direction = 0; direction < 2; ++direction, std::swap(a, b)) {
+				if (s.locked[a] || s.position[a] == s.position[b] || !skinCompatible(s, a, b)) {
+					continue;
+				}
+				Quadric q = s.quadrics[s.position[a]];
+				q.add(s.quadrics[s.position[b]]);
+				Collapse collapse = { a, b, q.evaluate(s.mesh->vertex[b]) };
+				out.push_back(collapse);
+			}
+		}
+	}
+}
+
+namespace {
+
+// Evaluates one trianglesPerJob range per index into its own candidate list.
+struct CandidateJob {
+	const Simplifier* s;
+	const std::vector<unsigned int>* indices;
+	std::vector<Collapse>* jobs;
+
+	void operator()(size_t first, size_t last) const {
+		size_t numTriangles = indices->size() / 3;
+		for (size_t job = first; job < last; ++job) {
+			size_t firstTriangle = job * trianglesPerJob;
+			evaluateCandidates(*s, *indices, firstTriangle, std::min(firstTriangle + trianglesPerJob, numTriangles), jobs[job]);
+		}
+	}
+};
+
+}
+
+static aiVector3D triangleNormal(const aiVector3D& a, const aiVector3D& b, const aiVector3D& c) {
+	return (b - a) ^ (c - a);
+}
+
+// Runs one pass of non-overlapping collapses. Returns the number of collapses made and
+// raises maxCost to the most expensive one.
+static size_t simplifyPass(Simplifier& s, std::vector<unsigned int>& indices, size_t targetTriangles,
+	double maxCostLimit, double& maxCost, unsigned int threadCount) {
+
+	const std::vector<aiVector3D>& vertex = s.mesh->vertex;
+	size_t numTriangles = indices.size() / 3;
+
+	std::vector< std::vector<Collapse> > jobs((numTriangles + trianglesPerJob - 1) / trianglesPerJob);
+	if (!jobs.empty()) {
+		CandidateJob job = { &s, &indices, &jobs[0] };
+		parallelFor(jobs.size(), 1, threadCount, job);
+	}
+
+	std::vector<Collapse> candidates;
+	for (size_t i = 0; i < jobs.size(); ++i) {
+		candidates.insert(candidates.end(), jobs[i].begin(), jobs[i].end());
+	}
+	if (candidates.empty()) {
+		return 0;
+	}
+	std::sort(candidates.begin(), candidates.end());
+
+	// Only take collapses up to a bit above the cost needed to reach the target, so a pass
+	// does not settle for expensive collapses while cheaper ones are merely blocked.
+	size_t wanted = (numTriangles - targetTriangles) / 2 + 1;
+	double passLimit = std::min(maxCostLimit, candidates[std::min(wanted, candidates.size() - 1)].cost * 1.5);
+
+	// vertex -> triangles
+	size_t numVertices = vertex.size();
+	std::vector<unsigned int> offsets(numVertices + 1, 0);
+	for (size_t i = 0; i < indices.size(); ++i) {
+		++offsets[indices[i] + 1];
+	}
+	for (size_t v = 0; v < numVertices; ++v) {
+		offsets[v + 1] += offsets[v];
+	}
+	std::vector<unsigned int> adjacency(indices.size());
+	std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+	for (size_t i = 0; i < indices.size(); ++i) {
+		adjacency[fill[indices[i]]++] = i / 3;
+	}
+
+	std::vector<unsigned int> remap(numVertices);
+	for (size_t v = 0; v < numVertices; ++v) {
+		remap[v] = v;
+	}
+	std::vector<bool> touched(numVertices, false);
+
+	size_t collapses = 0;
+	size_t removed = 0;
+	for (size_t i = 0; i < candidates.size() && numTriangles - removed > targetTriangles; ++i) {
+		const Collapse& collapse = candidates[i];
+		if (collapse.cost > passLimit) {
+			break;
+		}
+		unsigned int a = collapse.from, b = collapse.to;
+		if (touched[a] || touched[b]) {
+			continue;
+		}
+
+		// Reject collapses that flip or flatten a triangle around a.
+		bool flips = false;
+		size_t dying = 0;
+		for (unsigned int k = offsets[a]; k < offsets[a + 1] && !flips; ++k) {
+			const unsigned int* triangle = &indices[adjacency[k] * 3];
+			if (triangle[0] == b || triangle[1] == b || triangle[2] == b) {
+				++dying;
+				continue;
+			}
+			unsigned int corner = triangle[0] == a ? 0 : triangle[1] == a ? 1 : 2;
+			const aiVector3D& p1 = vertex[triangle[(corner + 1) % 3]];
+			const aiVector3D& p2 = vertex[triangle[(corner + 2) % 3]];
+			aiVector3D before = triangleNormal(vertex[a], p1, p2);
+			aiVector3D after = triangleNormal(vertex[b], p1, p2);
+			flips = before * after <= 1e-2f * before.Length() * after.Length();
+		}
+		if (flips) {
+			continue;
+		}
+
+		remap[a] = b;
+		s.quadrics[s.position[b]].add(s.quadrics[s.position[a]]);
+		for (unsigned int k = offsets[a]; k < offsets[a + 1]; ++k) {
+			const unsigned int* triangle = &indices[adjacency[k] * 3];
+			touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+		}
+		touched[b] = true;
+
+		maxCost = std::max(maxCost, collapse.cost);
+		removed += dying;
+		++collapses;
+	}
+
+	size_t write = 0;
+	for (size_t t = 0; t < numTriangles; ++t) {
+		unsigned int i0 = remap[indices[t * 3 + 0]];
+		unsigned int i1 = remap[indices[t * 3 + 1]];
+		unsigned int i2 = remap[indices[t * 3 + 2]];
+		unsigned int p0 = s.position[i0], p1 = s.position[i1], p2 = s.position[i2];
+		if (p0 == p1 || p1 == p2 || p0 == p2) {
+			continue;
+		}
+		indices[write++] = i0;
+		indices[write++] = i1;
+		indices[write++] = i2;
+	}
+	indices.resize(write);
+
+	return collapses;
+}
+
+// Returns vertex -> first vertex with identical attributes.
+static std::vector<unsigned int> weldVertices(const Mesh& mesh, const Simplifier& s) {
+	size_t numVertices = mesh.vertex.size();
+	std::vector<float> keys;
+	const unsigned int stride = 3 + 3 + 2 + influencesPerVertex * 2;
+	keys.reserve(numVertices * stride);
+	for (size_t v = 0; v < numVertices; ++v) {
+		const aiVector3D& p = mesh.vertex[v];
+		aiVector3D n = v < mesh.normal.size() ? mesh.normal[v] : aiVector3D();
+		aiVector3D uv = v < mesh.uv.size() ? mesh.uv[v] : aiVector3D();
+		float key[3 + 3 + 2] = { p.x, p.y, p.z, n.x, n.y, n.z, uv.x, uv.y };
+		keys.insert(keys.end(), key, key + 8);
+		for (unsigned int i = 0; i < influencesPerVertex; ++i) {
+			keys.push_back(s.skinIndex.empty() ? 0.0f : s.skinIndex[v * influencesPerVertex + i]);
+			keys.push_back(s.skinWeight.empty() ? 0.0f : s.skinWeight[v * influencesPerVertex + i]);
+		}
+	}
+
+	std::vector<unsigned int> order(numVertices);
+	for (size_t v = 0; v < numVertices; ++v) {
+		order[v] = v;
+	}
+	struct KeyLess {
+		const float* keys;
+		unsigned int stride;
+		bool operator()(unsigned int a, unsigned int b) const {
+			return std::lexicographical_compare(keys + a * stride, keys + (a + 1) * stride, keys + b * stride, keys + (b + 1) * stride)
+				|| (std::equal(keys + a * stride, keys + (a + 1) * stride, keys + b * stride) && a < b);
+		}
+	};
+	KeyLess less = { keys.empty() ? NULL : &keys[0], stride };
+	std::sort(order.begin(), order.end(), less);
+
+	std::vector<unsigned int> remap(numVertices);
+	for (size_t i = 0; i < numVertices; ++i) {
+		bool same = i > 0 && std::equal(&keys[order[i] * stride], &keys[order[i] * stride] + stride, &keys[order[i - 1] * stride]);
+		remap[order[i]] = same ? remap[order[i - 1]] : order[i];
+	}
+	return remap;
+}
+
+std::vector<Lod> buildLods(const Mesh& mesh, const LodOptions& options) {
+	StageAllocations stageAllocations("buildLods");
+	std::cout << "\n\nBuilding LODs.";
+
+	std::vector<Lod> lods;
+	size_t numVertices = mesh.vertex.size();
+	if (numVertices == 0 || mesh.index.size() < 3) {
+		return lods;
+	}
+
+	Simplifier s;
+	s.mesh = &mesh;
+	s.skinWeightTolerance = options.skinWeightTolerance;
+	if (!mesh.bones.empty()) {
+		collectSkinInfluences(mesh, influencesPerVertex, s.skinIndex, s.skinWeight);
+	}
+
+	std::vector<unsigned int> weld = weldVertices(mesh, s);
+	std::vector<unsigned int> indices(mesh.index.size() - mesh.index.size() % 3);
+	for (size_t i = 0; i < indices.size(); ++i) {
+		indices[i] = weld[mesh.index[i]];
+	}
+
+	// Welded positions: weld representatives sharing a position get the same id.
+	s.position.resize(numVertices);
+	std::vector<unsigned int> positionOwner;
+	{
+		std::map<std::vector<float>, unsigned int> positions;
+		std::vector<float> key(3);
+		for (size_t v = 0; v < numVertices; ++v) {
+			key[0] = mesh.vertex[v].x; key[1] = mesh.vertex[v].y; key[2] = mesh.vertex[v].z;
+			std::map<std::vector<float>, unsigned int>::iterator it = positions.find(key);
+			if (it == positions.end()) {
+				it = positions.insert(std::make_pair(key, (unsigned int)positionOwner.size())).first;
+				positionOwner.push_back(v);
+			}
+			s.position[v] = it->second;
+		}
+	}
+	size_t numPositions = positionOwner.size();
+
+	// Seams: a position referenced through more than one (welded) vertex.
+	s.locked.assign(numVertices, false);
+	std::vector<int> positionVertex(numPositions, -1);
+	std::vector<bool> seam(numPositions, false);
+	for (size_t i = 0; i < indices.size(); ++i) {
+		int& first = positionVertex[s.position[indices[i]]];
+		if (first < 0) {
+			first = indices[i];
+		} else if (first != (int)indices[i]) {
+			seam[s.position[indices[i]]] = true;
+		}
+	}
+
+	// Borders and non-manifold edges: position edges not shared by exactly two triangles.
+	std::vector< std::pair<unsigned int, unsigned int> > edges;
+	edges.reserve(indices.size());
+	for (size_t t = 0; t < indices.size(); t += 3) {
+		for (unsigned int e = 0; e < 3; ++e) {
+			unsigned int p0 = s.position[indices[t + e]], p1 = s.position[indices[t + (e + 1) % 3]];
+			edges.push_back(std::make_pair(std::min(p0, p1), std::max(p0, p1)));
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+	for (size_t i = 0; i < edges.size();) {
+		size_t j = i;
+		while (j < edges.size() && edges[j] == edges[i]) ++j;
+		if (j - i != 2) {
+			seam[edges[i].first] = seam[edges[i].second] = true;
+		}
+		i = j;
+	}
+	for (size_t v = 0; v < numVertices; ++v) {
+		s.locked[v] = seam[s.position[v]];
+	}
+
+	// Area weighted plane quadrics, accumulated per position.
+	s.quadrics.assign(numPositions, Quadric());
+	aiVector3D lo = mesh.vertex[0], hi = mesh.vertex[0];
+	for (size_t v = 1; v < numVertices; ++v) {
+		for (unsigned int c = 0; c < 3; ++c) {
+			lo[c] = std::min(lo[c], mesh.vertex[v][c]);
+			hi[c] = std::max(hi[c], mesh.vertex[v][c]);
+		}
+	}
+	double extent = std::max(1e-6f, (hi - lo).Length());
+	for (size_t t = 0; t < indices.size(); t += 3) {
+		const aiVector3D& p0 = mesh.vertex[indices[t]];
+		aiVector3D n = triangleNormal(p0, mesh.vertex[indices[t + 1]], mesh.vertex[indices[t + 2]]);
+		double length = n.Length();
+		if (length == 0.0) {
+			continue;
+		}
+		double nx = n.x / length, ny = n.y / length, nz = n.z / length;
+		double d = -(nx * p0.x + ny * p0.y + nz * p0.z);
+		for (unsigned int k = 0; k < 3; ++k) {
+			s.quadrics[s.position[indices[t + k]]].addPlane(nx, ny, nz, d, length * 0.5);
+		}
+	}
+
+	size_t originalTriangles = indices.size() / 3;
+	double maxCost = 0.0;
+
+	for (size_t level = 0; level < options.targets.size(); ++level) {
+		const LodTarget& target = options.targets[level];
+		size_t targetTriangles = size_t(std::max(0.0f, target.ratio) * originalTriangles);
+		double maxCostLimit = target.maxError >= FLT_MAX ? DBL_MAX : std::pow(double(target.maxError) * extent, 2.0);
+
+		while (indices.size() / 3 > targetTriangles) {
+			if (simplifyPass(s, indices, targetTriangles, maxCostLimit, maxCost, options.threadCount) == 0) {
+				break;
+			}
+		}
+
+		Lod lod;
+		lod.index.assign(indices.begin(), indices.end());
+		lod.error = float(std::sqrt(maxCost) / extent);
+		std::cout << "\n    LOD " << level << ": " << lod.index.size() / 3 << " triangles, error " << lod.error;
+		lods.push_back(std::move(lod));
+	}
+
+	return lods;
+}
+
+Json::Value lodsToJson(const std::vector<Lod>& lods, bool base64) {
+	Json::Value root = Json::Value(Json::arrayValue);
+	for (size_t i = 0; i < lods.size(); ++i) {
+		const Lod& lod = lods[i];
+		Json::Value level;
+		level["error"] = lod.error;
+		level["triangles"] = (Json::UInt)(lod.index.size() / 3);
+		level.emplace("index", indexArrayToJson(lod.index, base64));
+
+		root.append(std::move(level));
+	}
+	return root;
+}
@@ -0,0 +1,64 @@
+#ifndef ASSIMP_TO_JSON_LOD_H
+#define ASSIMP_TO_JSON_LOD_H
+
+#include <cfloat>
+#include <vector>
+
+#include <json\json.h>
+
+#include "mesh.h"
+
+/*
+
+Builds a chain of levels of detail with quadric error edge-collapse simplification.
+
+First, vertices that match in position, normal, first UV and skin influences are welded.
+Every level is then a new index buffer over the same (unchanged) vertex buffer. Each
+collapse moves one vertex onto a neighbouring vertex that already exists, so no vertex
+is created.
+
+Vertices on UV/normal seams, open borders and non-manifold edges never move, so seams
+stay intact. A collapse is also rejected when the two vertices' skin weights differ by
+more than skinWeightTolerance (summed absolute difference). This stops joints from
+being smeared across bones.
+
+Levels are produced in order; each continues from the previous one. A level stops at
+the first of two limits:
+	- its triangle count reaches ratio * the original count;
+	- the next collapse would exceed maxError, measured as distance relative to the
+	  mesh's bounding box diagonal. The distance is the root of the area-weighted mean
+	  squared distance to the planes of the triangles merged into the kept vertex.
+
+Each simplification pass evaluates its edge costs on threadCount threads.
+
+*/
+
+struct LodTarget {
+	LodTarget() : ratio(0.0f), maxError(FLT_MAX) {}
+
+	float ratio;
+	float maxError;
+};
+
+struct LodOptions {
+	LodOptions() : skinWeightTolerance(0.1f), threadCount(0) {}
+
+	std::vector<LodTarget> targets;
+	float skinWeightTolerance;
+	// 0 uses std::thread::hardware_concurrency().
+	unsigned int threadCount;
+};
+
+struct Lod {
+	std::vector<unsigned int> index;
+	// Largest collapse error so far, relative to the bounding box diagonal.
+	float error;
+};
+
+std::vector<Lod> buildLods(const Mesh& mesh, const LodOptions& options);
+
+// One entry per level with "error", "triangles" and "index", the index being a Uint16Array
+// (Uint32Array past 65,535 vertices) in the same typed array form as the BufferGeometry attributes.
+Json::Value lodsToJson(const std::vector<Lod>& lods, bool base64);
+
+#endif
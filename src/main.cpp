@@ -1,5 +1,9 @@
 #include <iostream>
 #include <fstream>
+#include <utility>
+#include <cstdlib>
+#include <cfloat>
+#include <algorithm>
 
 #include <json\json.h>
 #include <json\json-forwards.h>
@@ -7,57 +11,107 @@
 #include <assimp\scene.h>
 #include <glm\glm.hpp>
 
-struct AnimationKeys {
-	std::vector<aiQuatKey> rotationKeys;
-	std::vector<aiVectorKey> positionKeys;
-	std::vector<aiVectorKey> scaleKeys;
-};
+#include "allocationcounter.h"
+#include "mesh.h"
+#include "buffergeometry.h"
+#include "gltf.h"
+#include "meshlets.h"
+#include "lod.h"
+#include "bvh.h"
+#include "animationbounds.h"
+#include "bakedanimation.h"
+#include "skeleton.h"
+#include "normals.h"
+#include "vertexlayout.h"
+#include "morphtargets.h"
+#include "rotationpacking.h"
+#include "resample.h"
+#include "animationfiles.h"
 
-struct MeshBone {
-	int index;
-	int pindex;
-	aiMatrix4x4 nodeTransform;
-	std::string parentName;
-	std::map<int, float> weights;
-	std::map<std::string, AnimationKeys> animations;
-};
+void pause() {
+	std::cout << "\n\n";
+	system("PAUSE");
+}
 
-struct AnimationInfo {
-	float length;
-	float fps;
+// three.js JSON format 3 face type bits.
+static const int faceMaterial = 1 << 1;
+static const int faceVertexUv = 1 << 3;
+static const int faceVertexNormal = 1 << 5;
+
+struct LegacyOptions {
+	LegacyOptions() : compactFaces(false), compactFaceNormals(false), animationTracks(false), rotationBits(0), base64(false) {}
+
+	// Legacy faces are "10, a, b, c, 0, i, i+1, i+2": a material index and UV indices per
+	// face corner. Compact faces index the per-vertex uvs with the vertex indices and only set
+	// the UV bit when the mesh has uvs. With a single material, the index is left to the
+	// loader's default of 0.
+	bool compactFaces;
+	// Also sets the vertex normal bit, indexing the per-vertex normals. Legacy faces never
+	// reference normals, and this adds three values per face, so it is off by default.
+	bool compactFaceNormals;
+	// Each hierarchy entry gets "tracks" (pos, rot and scl, each with its own "times" and
+	// "values") instead of "keys". Keys hold whichever channels have a key at that time.
+	bool animationTracks;
+	// Packs track rotations with smallest-three encoding at this many bits per component,
+	// clamped to [2, 15] (see rotationpacking.h); 0 writes them as floats.
+	unsigned int rotationBits;
+	bool base64;
 };
 
-struct Mesh {
-	std::string name;
-	int numFaces;
-	std::vector<aiVector3D> vertex;
-	std::vector<aiVector3D> normal;
-	std::vector<aiVector3D> uv;
-	std::vector<unsigned short> index;
-	std::string diffuseMap;
-	std::string normalMap;
-	std::map< std::string, MeshBone > bones;
-	std::map< std::string, AnimationInfo > animations;
-
-	std::string error;
-};
+static Json::Value vectorTrackToJson(const std::vector<aiVectorKey>& keys) {
+	Json::Value track;
+	Json::Value& times = track.emplace("times", Json::Value(Json::arrayValue));
+	Json::Value& values = track.emplace("values", Json::Value(Json::arrayValue));
+	for (size_t k = 0; k < keys.size(); ++k) {
+		times.append(keys[k].mTime);
+		values.append(keys[k].mValue.x);
+		values.append(keys[k].mValue.y);
+		values.append(keys[k].mValue.z);
+	}
+	return track;
+}
 
-struct VertexBoneWeights {
-	std::vector<int> boneIds;
-	std::vector<float> boneWeights;
-};
+static Json::Value rotationTrackToJson(const std::vector<aiQuatKey>& keys) {
+	Json::Value track;
+	Json::Value& times = track.emplace("times", Json::Value(Json::arrayValue));
+	Json::Value& values = track.emplace("values", Json::Value(Json::arrayValue));
+	for (size_t k = 0; k < keys.size(); ++k) {
+		times.append(keys[k].mTime);
+		values.append(keys[k].mValue.x);
+		values.append(keys[k].mValue.y);
+		values.append(keys[k].mValue.z);
+		values.append(keys[k].mValue.w);
+	}
+	return track;
+}
 
-typedef std::map< std::string, MeshBone >::iterator MeshBonesIterator;
-typedef std::map< std::string, AnimationInfo >::iterator AnimationInfoIterator;
-typedef std::map< std::string, AnimationKeys >::iterator AnimationKeysIterator;
-typedef std::map< int, VertexBoneWeights >::iterator VertexBoneWeightsIterator;
+static void appendKeyVector(Json::Value& key, const char* channel, const aiVector3D& value) {
+	Json::Value& array = key.emplace(channel, Json::Value(Json::arrayValue));
+	array.append(value.x);
+	array.append(value.y);
+	array.append(value.z);
+}
 
-void pause() {
-	std::cout << "\n\n";
-	system("PAUSE");
+static void appendKeyRotation(Json::Value& key, const aiQuaternion& value) {
+	Json::Value& array = key.emplace("rot", Json::Value(Json::arrayValue));
+	array.append(value.x);
+	array.append(value.y);
+	array.append(value.z);
+	array.append(value.w);
+}
+
+// Characters in the decimal form of value.
+static unsigned int decimalLength(unsigned int value) {
+	unsigned int length = 1;
+	while (value >= 10) {
+		value /= 10;
+		++length;
+	}
+	return length;
 }
 
-Json::Value meshToJM(Mesh mesh) {
+Json::Value meshToJM(const Mesh& mesh, const LegacyOptions& options) {
+	StageAllocations stageAllocations("meshToJM");
 	Json::Value root;
 	std::cout << "\n\nBuilding JSON.";
 
@@ -68,7 +122,7 @@ Json::Value meshToJM(Mesh mesh) {
 		vertices.append(mesh.vertex[i].y);
 		vertices.append(mesh.vertex[i].z);
 	};
-	root["vertices"] = vertices;
+	root.emplace("vertices", std::move(vertices));
 
 	Json::Value uvs = Json::Value(Json::arrayValue);
 	int numUVs = mesh.uv.size();
@@ -76,21 +130,56 @@ Json::Value meshToJM(Mesh mesh) {
 		uvs.append(mesh.uv[i].x);
 		uvs.append(mesh.uv[i].y);
 	};
-	root["uvs"].append(uvs);
+	root["uvs"].append(std::move(uvs));
 
 	Json::Value faces = Json::Value(Json::arrayValue);
 	int numIndices = mesh.index.size();
-	for (unsigned int i = 0; i < numIndices; i+=3) {
-		faces.append(10);
-		faces.append(mesh.index[i]);
-		faces.append(mesh.index[i+1]);
-		faces.append(mesh.index[i+2]);
-		faces.append(0);
-		faces.append(i);
-		faces.append(i+1);
-		faces.append(i+2);
-	};
-	root["faces"] = faces;
+	if (options.compactFaces) {
+		bool hasUvs = !mesh.uv.empty();
+		bool hasNormals = options.compactFaceNormals && !mesh.normal.empty();
+		int faceType = (hasUvs ? faceVertexUv : 0) | (hasNormals ? faceVertexNormal : 0);
+		// Sizes of the faces array as compact JSON text ("[" and "]" aside), in both layouts.
+		size_t bytes = 0, legacyBytes = 0;
+		for (unsigned int i = 0; i + 2 < numIndices; i+=3) {
+			unsigned int corners = decimalLength(mesh.index[i]) + decimalLength(mesh.index[i+1]) + decimalLength(mesh.index[i+2]);
+			bytes += decimalLength(faceType) + corners * (1 + hasUvs + hasNormals) + 3 * (1 + hasUvs + hasNormals);
+			legacyBytes += decimalLength(faceMaterial | faceVertexUv) + corners + decimalLength(0)
+				+ decimalLength(i) + decimalLength(i+1) + decimalLength(i+2) + 7;
+
+			faces.append(faceType);
+			faces.append(mesh.index[i]);
+			faces.append(mesh.index[i+1]);
+			faces.append(mesh.index[i+2]);
+			if (hasUvs) {
+				faces.append(mesh.index[i]);
+				faces.append(mesh.index[i+1]);
+				faces.append(mesh.index[i+2]);
+			}
+			if (hasNormals) {
+				faces.append(mesh.index[i]);
+				faces.append(mesh.index[i+1]);
+				faces.append(mesh.index[i+2]);
+			}
+		};
+		// Separators: one comma after every value but the last.
+		size_t faceCount = numIndices / 3;
+		bytes += faceCount > 0 ? faceCount - 1 : 0;
+		legacyBytes += faceCount > 0 ? faceCount - 1 : 0;
+		std::cout << "\nCompact faces: type " << faceType << ", " << bytes << " bytes ("
+			<< legacyBytes << " in the legacy layout).";
+	} else {
+		for (unsigned int i = 0; i < numIndices; i+=3) {
+			faces.append(faceMaterial | faceVertexUv);
+			faces.append(mesh.index[i]);
+			faces.append(mesh.index[i+1]);
+			faces.append(mesh.index[i+2]);
+			faces.append(0);
+			faces.append(i);
+			faces.append(i+1);
+			faces.append(i+2);
+		};
+	}
+	root.emplace("faces", std::move(faces));
 
 	Json::Value normals = Json::Value(Json::arrayValue);
 	int numNormals = mesh.normal.size();
@@ -99,7 +188,7 @@ Json::Value meshToJM(Mesh mesh) {
 		normals.append(mesh.normal[i].y);
 		normals.append(mesh.normal[i].z);
 	};
-	root["normals"] = normals;
+	root.emplace("normals", std::move(normals));
 
 	Json::Value metadata;
 	metadata["formatVersion"] = 3.1f;
@@ -108,7 +197,7 @@ Json::Value meshToJM(Mesh mesh) {
 	metadata["vertices"] = numVertices;
 	metadata["faces"] = mesh.numFaces;
 	metadata["description"] = "void.";
-	root["metadata"] = metadata;
+	root.emplace("metadata", std::move(metadata));
 
 	Json::Value materials = Json::Value(Json::arrayValue);
 
@@ -118,31 +207,38 @@ Json::Value meshToJM(Mesh mesh) {
 	material["DbgName"] = "cube_mat";
 	material["mapDiffuse"] = mesh.diffuseMap;
 	//material["mapNormal"] = mesh.normalMap;
-	materials.append(material);
-	root["materials"] = materials;
+	materials.append(std::move(material));
+	root.emplace("materials", std::move(materials));
 
 	Json::Value bones          = Json::Value(Json::arrayValue);
 	Json::Value skinIndices    = Json::Value(Json::arrayValue);
 	Json::Value skinWeights    = Json::Value(Json::arrayValue);
 
-	Json::Value animation;
-	for (AnimationInfoIterator it = mesh.animations.begin(); it != mesh.animations.end(); ++it) {
-		AnimationInfo info = it->second;
+	double rotationMaxError = 0.0, rotationErrorSum = 0.0;
+	size_t packedRotationKeys = 0;
+	unsigned int packedRotationBits = 0;
+
+	// One entry per clip, in mesh.animations order.
+	std::vector<Json::Value> animations;
+	for (AnimationInfoConstIterator it = mesh.animations.begin(); it != mesh.animations.end(); ++it) {
+		const AnimationInfo& info = it->second;
+		Json::Value animation;
 		animation["name"] = it->first;
 		animation["length"] = info.length;
 		animation["fps"] = info.fps;
 		animation["JIT"] = 0;
 		animation["hierarchy"] = Json::Value(Json::arrayValue);
+		animations.push_back(std::move(animation));
 	}
 
-	for (MeshBonesIterator i = mesh.bones.begin(); i != mesh.bones.end(); ++i) {
+	for (MeshBonesConstIterator i = mesh.bones.begin(); i != mesh.bones.end(); ++i) {
 		Json::Value jsonBone;
-		MeshBone bone = i->second;
-		std::string boneName = i->first;
+		const MeshBone& bone = i->second;
+		const std::string& boneName = i->first;
 		jsonBone["name"] = boneName;
 		jsonBone["parent"] = bone.pindex;
 
-		aiMatrix4x4 om = bone.nodeTransform;
+		const aiMatrix4x4& om = bone.nodeTransform;
 		aiVector3D dscl; aiQuaternion drot; aiVector3D dpos;
 		om.Decompose(dscl, drot, dpos);
 
@@ -153,9 +249,9 @@ Json::Value meshToJM(Mesh mesh) {
 		Json::Value scl = Json::Value(Json::arrayValue);
 		scl.append(dscl.x); scl.append(dscl.y); scl.append(dscl.z);
 
-		jsonBone["pos"] = pos;
-		jsonBone["scl"] = scl;
-		jsonBone["rotq"] = rotq;
+		jsonBone.emplace("pos", std::move(pos));
+		jsonBone.emplace("scl", std::move(scl));
+		jsonBone.emplace("rotq", std::move(rotq));
 
 		/* 
 		
@@ -168,7 +264,7 @@ Json::Value meshToJM(Mesh mesh) {
 
 		*/
 
-		bones[bone.index] = jsonBone;
+		bones[bone.index] = std::move(jsonBone);
 
 		std::map<int, VertexBoneWeights> vertexWeights;
 
@@ -184,7 +280,7 @@ Json::Value meshToJM(Mesh mesh) {
 
 		*/
 
-		typedef std::map<int, float>::iterator it_type;
+		typedef std::map<int, float>::const_iterator it_type;
 		for(it_type it = bone.weights.begin(); it != bone.weights.end(); it++) {
 
 			int vertexId = it->first;
@@ -197,10 +293,10 @@ Json::Value meshToJM(Mesh mesh) {
 			w->boneWeights.push_back(it->second);
 		}
 
-		for( VertexBoneWeightsIterator it = vertexWeights.begin(); it != vertexWeights.end(); ++it ) {
+		for( VertexBoneWeightsConstIterator it = vertexWeights.begin(); it != vertexWeights.end(); ++it ) {
 			
 			int vertexId = it->first;
-			VertexBoneWeights w = it->second;
+			const VertexBoneWeights& w = it->second;
 
 			int boneId = w.boneIds[0];
 			float boneWeight = w.boneWeights[0];
@@ -211,61 +307,136 @@ Json::Value meshToJM(Mesh mesh) {
 
 		}
 
-		root["skinWeights"] = skinWeights;
-		root["skinIndices"] = skinIndices;
+		size_t clip = 0;
+		for (AnimationInfoConstIterator j = mesh.animations.begin(); j != mesh.animations.end(); ++j, ++clip) {
+			Json::Value& hierarchy = animations[clip]["hierarchy"];
 
-		for (AnimationInfoIterator j = mesh.animations.begin(); j != mesh.animations.end(); ++j) {
-
-			std::string animationName = j->first;
-			AnimationKeys animationKeys = bone.animations[animationName];
+			// Bones without a channel in this animation still get a hierarchy entry.
+			static const AnimationKeys noAnimationKeys;
+			AnimationKeysConstIterator found = bone.animations.find(j->first);
+			const AnimationKeys& animationKeys = found != bone.animations.end() ? found->second : noAnimationKeys;
 
 			Json::Value hierarchyBone;
 			hierarchyBone["parent"] = bone.pindex;
-			hierarchyBone["keys"] = Json::Value(Json::arrayValue);
 
-			for (unsigned int l = 0; l < animationKeys.rotationKeys.size(); ++l) {
+			const std::vector<aiQuatKey>& rotationKeys = animationKeys.rotationKeys;
+			const std::vector<aiVectorKey>& positionKeys = animationKeys.positionKeys;
+			const std::vector<aiVectorKey>& scaleKeys = animationKeys.scaleKeys;
+
+			if (options.animationTracks) {
+				Json::Value& tracks = hierarchyBone.emplace("tracks", Json::Value(Json::objectValue));
+				if (!positionKeys.empty()) {
+					tracks.emplace("pos", vectorTrackToJson(positionKeys));
+				}
+				if (!rotationKeys.empty() && options.rotationBits) {
+					PackedRotations packed = packRotations(rotationKeys, options.rotationBits);
+					rotationMaxError = std::max(rotationMaxError, packed.maxErrorDegrees);
+					rotationErrorSum += packed.sumErrorDegrees;
+					packedRotationKeys += packed.count;
+					packedRotationBits = packed.bits;
+
+					Json::Value track = packedRotationsToJson(packed, options.base64);
+					Json::Value& times = track.emplace("times", Json::Value(Json::arrayValue));
+					for (size_t k = 0; k < rotationKeys.size(); ++k) {
+						times.append(rotationKeys[k].mTime);
+					}
+					tracks.emplace("rot", std::move(track));
+				} else if (!rotationKeys.empty()) {
+					tracks.emplace("rot", rotationTrackToJson(rotationKeys));
+				}
+				if (!scaleKeys.empty()) {
+					tracks.emplace("scl", vectorTrackToJson(scaleKeys));
+				}
+				hierarchy.append(std::move(hierarchyBone));
+				continue;
+			}
+
+			// Channels are keyed independently, so walk the three in time order and give
+			// each key only the channels that have a key at its time. THREE.Animation starts
+			// every channel from the first key and ends it on the last one, so those two carry
+			// all three channels, held or interpolated where the channel has no key there.
+			Json::Value& keys = hierarchyBone.emplace("keys", Json::Value(Json::arrayValue));
+			if (rotationKeys.empty() && positionKeys.empty() && scaleKeys.empty()) {
+				// No channel in this clip: hold the rest pose over the whole clip.
+				double times[2] = { 0.0, j->second.length };
+				for (unsigned int k = 0; k < 2; ++k) {
+					Json::Value key;
+					key["time"] = times[k];
+					appendKeyRotation(key, drot);
+					appendKeyVector(key, "pos", dpos);
+					appendKeyVector(key, "scl", dscl);
+					keys.append(std::move(key));
+				}
+			}
+			size_t r = 0, p = 0, s = 0;
+			while (r < rotationKeys.size() || p < positionKeys.size() || s < scaleKeys.size()) {
+				double time = DBL_MAX;
+				if (r < rotationKeys.size()) time = std::min(time, rotationKeys[r].mTime);
+				if (p < positionKeys.size()) time = std::min(time, positionKeys[p].mTime);
+				if (s < scaleKeys.size()) time = std::min(time, scaleKeys[s].mTime);
+
+				bool hasRotation = r < rotationKeys.size() && rotationKeys[r].mTime == time;
+				bool hasPosition = p < positionKeys.size() && positionKeys[p].mTime == time;
+				bool hasScale = s < scaleKeys.size() && scaleKeys[s].mTime == time;
+				r += hasRotation;
+				p += hasPosition;
+				s += hasScale;
+				bool allChannels = keys.empty() || (r == rotationKeys.size() && p == positionKeys.size() && s == scaleKeys.size());
 
 				Json::Value key;
-
-				aiQuatKey rotationKey = animationKeys.rotationKeys[l];
-				key["time"] = rotationKey.mTime;
-				key["rot"] = Json::Value(Json::arrayValue);
-				key["rot"].append(rotationKey.mValue.x);
-				key["rot"].append(rotationKey.mValue.y);
-				key["rot"].append(rotationKey.mValue.z);
-				key["rot"].append(rotationKey.mValue.w);
-
-				aiVectorKey positionKey = animationKeys.positionKeys[l];
-				key["pos"] = Json::Value(Json::arrayValue);
-				key["pos"].append(positionKey.mValue.x);
-				key["pos"].append(positionKey.mValue.y);
-				key["pos"].append(positionKey.mValue.z);
-
-				aiVectorKey scaleKey = animationKeys.scaleKeys[l];
-				key["scl"] = Json::Value(Json::arrayValue);
-				key["scl"].append(scaleKey.mValue.x);
-				key["scl"].append(scaleKey.mValue.y);
-				key["scl"].append(scaleKey.mValue.z);
-
-				hierarchyBone["keys"].append(key);
+				key["time"] = time;
+				if (hasRotation || allChannels) {
+					appendKeyRotation(key, hasRotation ? rotationKeys[r - 1].mValue : sampleRotationKeys(rotationKeys, time, drot));
+				}
+				if (hasPosition || allChannels) {
+					appendKeyVector(key, "pos", hasPosition ? positionKeys[p - 1].mValue : sampleVectorKeys(positionKeys, time, dpos));
+				}
+				if (hasScale || allChannels) {
+					appendKeyVector(key, "scl", hasScale ? scaleKeys[s - 1].mValue : sampleVectorKeys(scaleKeys, time, dscl));
+				}
+				keys.append(std::move(key));
 			}
 
-			animation["hierarchy"].append(hierarchyBone);
+			hierarchy.append(std::move(hierarchyBone));
 
 		}
 
 	}
 
-	root["animation"] = animation;
-	root["bones"] = bones;
+	if (packedRotationKeys > 0) {
+		std::cout << "\nPacked " << packedRotationKeys << " rotation keys at " << packedRotationBits
+			<< " bits per component: max error " << rotationMaxError << " degrees, mean "
+			<< rotationErrorSum / packedRotationKeys << " degrees.";
+	}
+
+	// skinIndices/skinWeights accumulate across every bone, so they are only
+	// handed to the root once the bone loop is done.
+	if (!mesh.bones.empty()) {
+		root.emplace("skinWeights", std::move(skinWeights));
+		root.emplace("skinIndices", std::move(skinIndices));
+	}
+
+	// A single clip stays in "animation", as before; three.js loaders also read an
+	// "animations" array, which holds every clip when there are several.
+	if (animations.size() > 1) {
+		Json::Value& clips = root.emplace("animations", Json::Value(Json::arrayValue));
+		for (size_t a = 0; a < animations.size(); ++a) {
+			clips.append(std::move(animations[a]));
+		}
+	} else {
+		root.emplace("animation", animations.empty() ? Json::Value() : std::move(animations[0]));
+	}
+	root.emplace("bones", std::move(bones));
 
 	std::cout << "\nDone building JSON.";
 	return root;
 };
 
-bool writeJsonValueToFile(std::string filepath, Json::Value json) {
+bool writeJsonValueToFile(const std::string& filepath, const Json::Value& json) {
+	StageAllocations stageAllocations("writeJsonValueToFile");
 
-	Json::StyledWriter writer;
+	// Same output as Json::StyledWriter; the large top-level arrays are formatted concurrently.
+	Json::ParallelStyledWriter writer;
 	//Json::FastWriter writer;
 	//std::cout << writer.write(json); 
 
@@ -277,7 +448,8 @@ bool writeJsonValueToFile(std::string filepath, Json::Value json) {
 	return true;
 }
 
-Mesh populateMeshFromDae(std::string filePath) {
+Mesh populateMeshFromDae(const std::string& filePath) {
+	StageAllocations stageAllocations("populateMeshFromDae");
 	Assimp::Importer importer;
 	const aiScene* scene = importer.ReadFile(filePath, NULL);
 	Mesh mesh;
@@ -324,6 +496,29 @@ Mesh populateMeshFromDae(std::string filePath) {
 		}
 	}
 
+	// Targets with a different vertex count cannot be matched to the mesh vertices.
+	for (unsigned int i = 0; i < m->mNumAnimMeshes; ++i) {
+		const aiAnimMesh* animMesh = m->mAnimMeshes[i];
+		if (!animMesh->HasPositions() || animMesh->mNumVertices != numVertices) {
+			std::cout << "\nSkipping morph target " << i << ", its vertices do not match the mesh.";
+			continue;
+		}
+		MorphTarget target;
+		target.name = animMesh->mName.C_Str();
+		if (target.name.empty()) {
+			target.name = "morph" + std::to_string(i);
+		}
+		target.weight = animMesh->mWeight;
+		target.vertex.assign(animMesh->mVertices, animMesh->mVertices + numVertices);
+		if (animMesh->HasNormals()) {
+			target.normal.assign(animMesh->mNormals, animMesh->mNormals + numVertices);
+		}
+		mesh.morphTargets.push_back(std::move(target));
+	}
+	if (!mesh.morphTargets.empty()) {
+		std::cout << "\nMorph targets: " << mesh.morphTargets.size();
+	}
+
 	int numFaces = m->mNumFaces;
 	std::cout << "\nNum Faces: " << numFaces;
 	mesh.numFaces = numFaces;
@@ -415,6 +610,7 @@ Mesh populateMeshFromDae(std::string filePath) {
 			mesh.bones[boneName].index = i;
 			mesh.bones[boneName].parentName = parentNode->mName.C_Str();
 			mesh.bones[boneName].nodeTransform = boneNode->mTransformation;
+			mesh.bones[boneName].offsetMatrix = bone->mOffsetMatrix;
 
 			int numWeights = bone->mNumWeights;
 			std::cout << "\n    Bone (name): " << boneName;
@@ -427,13 +623,12 @@ Mesh populateMeshFromDae(std::string filePath) {
 		};
 
 		// Populate the pindex property of each bone with the bone index of the bones parent.
+		// A parent that does not deform the mesh (the armature, or any other node) is not a
+		// bone, so the bone is a root.
 		for (MeshBonesIterator i = mesh.bones.begin(); i != mesh.bones.end(); ++i) {
 			MeshBone* meshBone = &i->second;
-			if (meshBone->parentName == armatureName) {
-				meshBone->pindex = -1;
-			} else {
-				meshBone->pindex = mesh.bones[meshBone->parentName].index;
-			}
+			MeshBonesConstIterator parent = mesh.bones.find(meshBone->parentName);
+			meshBone->pindex = parent != mesh.bones.end() ? parent->second.index : -1;
 		}
 
 		int numAnimations = scene->mNumAnimations;
@@ -458,20 +653,18 @@ Mesh populateMeshFromDae(std::string filePath) {
 
 				aiNodeAnim* animationChannel = animation->mChannels[j];
 				std::string boneName = animationChannel->mNodeName.C_Str();
-				int boneIndex = mesh.bones[boneName].index;
 
-				AnimationKeys* animationKeys = &mesh.bones[boneName].animations[animationName];
-				for (int k = 0; k < scene->mAnimations[i]->mChannels[boneIndex]->mNumRotationKeys; ++k) {
-					animationKeys->rotationKeys.push_back(animationChannel->mRotationKeys[k]);
-				};
+				// Channels can also animate nodes that do not deform the mesh.
+				MeshBonesIterator bone = mesh.bones.find(boneName);
+				if (bone == mesh.bones.end()) {
+					continue;
+				}
 
-				for (int k = 0; k < scene->mAnimations[i]->mChannels[boneIndex]->mNumPositionKeys; ++k) {
-					animationKeys->positionKeys.push_back(animationChannel->mPositionKeys[k]);
-				};
-
-				for (int k = 0; k < scene->mAnimations[i]->mChannels[boneIndex]->mNumScalingKeys; ++k) {
-					animationKeys->scaleKeys.push_back(animationChannel->mScalingKeys[k]);
-				};
+				// Each channel keeps its own key count and times.
+				AnimationKeys* animationKeys = &bone->second.animations[animationName];
+				animationKeys->rotationKeys.assign(animationChannel->mRotationKeys, animationChannel->mRotationKeys + animationChannel->mNumRotationKeys);
+				animationKeys->positionKeys.assign(animationChannel->mPositionKeys, animationChannel->mPositionKeys + animationChannel->mNumPositionKeys);
+				animationKeys->scaleKeys.assign(animationChannel->mScalingKeys, animationChannel->mScalingKeys + animationChannel->mNumScalingKeys);
 
 			};
 		};
@@ -483,6 +676,31 @@ Mesh populateMeshFromDae(std::string filePath) {
 	return mesh;
 };
 
+// Parses "0.5,0.25,0.1".
+std::vector<float> parseFloatList(const std::string& list) {
+	std::vector<float> values;
+	std::string::size_type start = 0;
+	while (start <= list.length()) {
+		std::string::size_type end = list.find(',', start);
+		if (end == std::string::npos) {
+			end = list.length();
+		}
+		if (end > start) {
+			values.push_back((float)atof(list.substr(start, end - start).c_str()));
+		}
+		start = end + 1;
+	}
+	return values;
+}
+
+// Parses a whole decimal integer in [minimum, maximum]. Returns false on anything else,
+// including trailing characters.
+bool parseInteger(const char* text, long minimum, long maximum, long& value) {
+	char* end = 0;
+	value = strtol(text, &end, 10);
+	return end != text && *end == '\0' && value >= minimum && value <= maximum;
+}
+
 int main (int argc, char* argv[]) {
 
 	std::cout << "\n****";
@@ -495,11 +713,155 @@ int main (int argc, char* argv[]) {
 
 	if (argc < 2) {
 		std::cout << "\nPlease specify a file to convert. Supported formats are determined by assimp.";
+		std::cout << "\n\nUsage: assimp-to-json <file> [--format legacy|buffergeometry|gltf|glb] [--compact-faces] [--compact-face-normals] [--animation-tracks] [--rotation-bits <bits>] [--base64] [--compress-indices] [--meshlets] [--lod <ratio,...>] [--lod-error <error,...>] [--bvh] [--animation-bounds] [--animation-bounds-per-frame] [--bake <fps>] [--bake-normals] [--resample <fps>] [--animation-files] [--crease-angle <degrees>] [--area-weighted-normals] [--tangents] [--max-index-duplication <ratio>] [--vertex-layout interleaved|separate] [--vertex-formats <name:format,...>] [--vertex-alignment <bytes>] [--morph-epsilon <value>] [--output <file>]";
 		pause();
 		return 1;
 	}
 	std::string filename = argv[1];
-	filename = "animBoxNewer.dae";
+	std::string outputFilename = "JSON.js";
+	bool outputSpecified = false;
+	LegacyOptions legacyOptions;
+	std::string format = "legacy";
+	BufferGeometryOptions bufferGeometryOptions;
+	bool exportMeshlets = false;
+	MeshletOptions meshletOptions;
+	LodOptions lodOptions;
+	bool exportBvh = false;
+	BvhOptions bvhOptions;
+	bool exportAnimationBounds = false;
+	AnimationBoundsOptions animationBoundsOptions;
+	bool exportBakedAnimations = false;
+	BakedAnimationOptions bakedAnimationOptions;
+	bool exportResampledAnimations = false;
+	bool splitAnimationFiles = false;
+	ResampleOptions resampleOptions;
+	NormalOptions normalOptions;
+	bool generateTangentFrames = false;
+	bool exportVertexLayout = false;
+	VertexLayoutOptions vertexLayoutOptions;
+	MorphTargetOptions morphTargetOptions;
+
+	for (int i = 2; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--format" && i + 1 < argc) {
+			format = argv[++i];
+		} else if (arg == "--output" && i + 1 < argc) {
+			outputFilename = argv[++i];
+			outputSpecified = true;
+		} else if (arg == "--compact-faces") {
+			legacyOptions.compactFaces = true;
+		} else if (arg == "--compact-face-normals") {
+			legacyOptions.compactFaces = true;
+			legacyOptions.compactFaceNormals = true;
+		} else if (arg == "--animation-tracks") {
+			legacyOptions.animationTracks = true;
+		} else if (arg == "--rotation-bits" && i + 1 < argc) {
+			legacyOptions.animationTracks = true;
+			long bits;
+			if (!parseInteger(argv[++i], 2, 15, bits)) {
+				std::cout << "\nInvalid rotation bits: " << argv[i] << " (expected 2 to 15)";
+				pause();
+				return 1;
+			}
+			legacyOptions.rotationBits = bits;
+		} else if (arg == "--base64") {
+			bufferGeometryOptions.base64 = true;
+		} else if (arg == "--compress-indices") {
+			bufferGeometryOptions.compressIndices = true;
+		} else if (arg == "--meshlets") {
+			exportMeshlets = true;
+		} else if (arg == "--bvh") {
+			exportBvh = true;
+		} else if (arg == "--animation-bounds" || arg == "--animation-bounds-per-frame") {
+			exportAnimationBounds = true;
+			animationBoundsOptions.perFrame = animationBoundsOptions.perFrame || arg == "--animation-bounds-per-frame";
+		} else if (arg == "--bake" && i + 1 < argc) {
+			exportBakedAnimations = true;
+			bakedAnimationOptions.sampleRate = (float)atof(argv[++i]);
+		} else if (arg == "--resample" && i + 1 < argc) {
+			exportResampledAnimations = true;
+			resampleOptions.sampleRate = (float)atof(argv[++i]);
+		} else if (arg == "--animation-files") {
+			splitAnimationFiles = true;
+		} else if (arg == "--bake-normals") {
+			bakedAnimationOptions.normals = true;
+		} else if (arg == "--crease-angle" && i + 1 < argc) {
+			normalOptions.creaseAngle = (float)atof(argv[++i]);
+		} else if (arg == "--area-weighted-normals") {
+			normalOptions.angleWeighted = false;
+		} else if (arg == "--tangents") {
+			generateTangentFrames = true;
+		} else if (arg == "--vertex-layout" && i + 1 < argc) {
+			exportVertexLayout = true;
+			std::string layout = argv[++i];
+			if (layout != "interleaved" && layout != "separate") {
+				std::cout << "\nUnknown vertex layout: " << layout;
+				pause();
+				return 1;
+			}
+			vertexLayoutOptions.interleaved = layout == "interleaved";
+		} else if (arg == "--vertex-formats" && i + 1 < argc) {
+			exportVertexLayout = true;
+			std::string error;
+			if (!parseVertexFormats(argv[++i], vertexLayoutOptions.attributes, error)) {
+				std::cout << "\nUnknown vertex format: " << error;
+				pause();
+				return 1;
+			}
+		} else if (arg == "--morph-epsilon" && i + 1 < argc) {
+			morphTargetOptions.epsilon = (float)atof(argv[++i]);
+		} else if (arg == "--vertex-alignment" && i + 1 < argc) {
+			long alignment;
+			if (!parseInteger(argv[++i], 1, 256, alignment)) {
+				std::cout << "\nInvalid vertex alignment: " << argv[i] << " (expected 1 to 256)";
+				pause();
+				return 1;
+			}
+			vertexLayoutOptions.alignment = alignment;
+		} else if (arg == "--max-index-duplication" && i + 1 < argc) {
+			bufferGeometryOptions.indexSplit.maxDuplication = (float)atof(argv[++i]);
+		} else if ((arg == "--lod" || arg == "--lod-error") && i + 1 < argc) {
+			std::vector<float> values = parseFloatList(argv[++i]);
+			if (lodOptions.targets.size() < values.size()) {
+				lodOptions.targets.resize(values.size());
+			}
+			for (unsigned int j = 0; j < values.size(); ++j) {
+				if (arg == "--lod") {
+					lodOptions.targets[j].ratio = values[j];
+				} else {
+					lodOptions.targets[j].maxError = values[j];
+				}
+			}
+		} else {
+			std::cout << "\nUnknown option: " << arg;
+			pause();
+			return 1;
+		}
+	}
+
+	if (format != "legacy" && format != "buffergeometry" && format != "gltf" && format != "glb") {
+		std::cout << "\nUnknown format: " << format;
+		pause();
+		return 1;
+	}
+
+	// The optional stages add members to the JSON document, which glTF output does not have.
+	if (format == "gltf" || format == "glb") {
+		std::string jsonOnly;
+		if (exportMeshlets) jsonOnly += " --meshlets";
+		if (!lodOptions.targets.empty()) jsonOnly += " --lod";
+		if (exportBvh) jsonOnly += " --bvh";
+		if (exportAnimationBounds) jsonOnly += " --animation-bounds";
+		if (exportBakedAnimations) jsonOnly += " --bake";
+		if (exportResampledAnimations) jsonOnly += " --resample";
+		if (splitAnimationFiles) jsonOnly += " --animation-files";
+		if (exportVertexLayout) jsonOnly += " --vertex-layout";
+		if (!jsonOnly.empty()) {
+			std::cout << "\nNot supported with --format " << format << ":" << jsonOnly;
+			pause();
+			return 1;
+		}
+	}
 
 	Mesh mesh = populateMeshFromDae(filename);
 	if (mesh.error.length() > 0) {
@@ -508,10 +870,69 @@ int main (int argc, char* argv[]) {
 		return 1;
 	}
 
-	Json::Value jm = meshToJM(mesh);
+	if (mesh.normal.empty()) {
+		generateNormals(mesh, normalOptions);
+	}
+	if (generateTangentFrames) {
+		generateTangents(mesh, normalOptions.threadCount);
+	}
+
+	if (format == "gltf" || format == "glb") {
+		GltfOptions gltfOptions;
+		gltfOptions.binary = format == "glb";
+		gltfOptions.indexSplit = bufferGeometryOptions.indexSplit;
+		if (!outputSpecified) {
+			outputFilename = gltfOptions.binary ? "model.glb" : "model.gltf";
+		}
+		if (!mesh.morphTargets.empty()) {
+			std::cout << "\nMorph targets are not written to glTF yet; skipping " << mesh.morphTargets.size() << ".";
+		}
+		bool written = writeGltf(outputFilename, mesh, gltfOptions);
+		pause();
+		return written ? 0 : 1;
+	}
+
+	legacyOptions.base64 = bufferGeometryOptions.base64;
+	Json::Value jm = format == "buffergeometry"
+		? meshToBufferGeometry(mesh, bufferGeometryOptions)
+		: meshToJM(mesh, legacyOptions);
+
+	// Not "morphTargets": the legacy loader reads that member as dense per-vertex arrays.
+	if (!mesh.morphTargets.empty()) {
+		jm.emplace("sparseMorphTargets", morphTargetsToJson(buildMorphTargets(mesh, morphTargetOptions), bufferGeometryOptions.base64));
+	}
+
+	// The cluster table sits next to the geometry; loaders that do not know it ignore it.
+	if (exportMeshlets) {
+		jm.emplace("meshlets", meshletsToJson(buildMeshlets(mesh, meshletOptions), meshletOptions, bufferGeometryOptions.base64));
+	}
+	if (!lodOptions.targets.empty()) {
+		jm.emplace("lods", lodsToJson(buildLods(mesh, lodOptions), bufferGeometryOptions.base64));
+	}
+	if (exportBvh) {
+		jm.emplace("bvh", bvhToJson(buildBvh(mesh, bvhOptions), bufferGeometryOptions.base64));
+	}
+	if (exportAnimationBounds) {
+		jm["metadata"].emplace("animationBounds", animationBoundsToJson(mesh, computeAnimationBounds(mesh, animationBoundsOptions)));
+	}
+	if (exportVertexLayout) {
+		jm.emplace("vertexLayout", vertexLayoutToJson(buildVertexLayout(mesh, vertexLayoutOptions)));
+	}
+	if (exportBakedAnimations) {
+		jm.emplace("bakedAnimations", bakedAnimationsToJson(bakeAnimations(mesh, bakedAnimationOptions), bufferGeometryOptions.base64));
+	}
+
+	if (exportResampledAnimations) {
+		jm.emplace("resampledAnimations", resampledAnimationsToJson(resampleAnimations(mesh, resampleOptions), bufferGeometryOptions.base64));
+	}
+
+	// Last, so the clips carry their baked and resampled data with them.
+	if (splitAnimationFiles && !writeAnimationFiles(mesh, jm, outputFilename)) {
+		pause();
+		return 1;
+	}
 
-	// Update so that the filename resembles the original filename.
-	writeJsonValueToFile("JSON.js", jm);
+	writeJsonValueToFile(outputFilename, jm);
 
 	pause();
 	return 0;
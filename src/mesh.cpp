@@ -0,0 +1,101 @@
+#include <sstream>
+
+#include "mesh.h"
+
+bool bonesByIndex(const Mesh& mesh, std::vector<const MeshBone*>& bones, std::string& error) {
+	int numBones = (int)mesh.bones.size();
+	bones.assign(numBones, NULL);
+	for (MeshBonesConstIterator i = mesh.bones.begin(); i != mesh.bones.end(); ++i) {
+		const MeshBone& bone = i->second;
+		std::ostringstream problem;
+		if (bone.index < 0 || bone.index >= numBones) {
+			problem << "bone \"" << i->first << "\" has index " << bone.index << ", outside [0, " << numBones << ")";
+		} else if (bones[bone.index]) {
+			problem << "bones share index " << bone.index << " (\"" << i->first << "\")";
+		} else if (bone.pindex < -1 || bone.pindex >= numBones) {
+			problem << "bone \"" << i->first << "\" has parent index " << bone.pindex;
+		}
+		if (!problem.str().empty()) {
+			error = problem.str();
+			bones.clear();
+			return false;
+		}
+		bones[bone.index] = &bone;
+	}
+	return true;
+}
+
+void collectSkinInfluences(const Mesh& mesh, unsigned int influencesPerVertex,
+	std::vector<unsigned short>& boneIndices, std::vector<float>& boneWeights) {
+
+	size_t numVertices = mesh.vertex.size();
+	boneIndices.assign(numVertices * influencesPerVertex, 0);
+	boneWeights.assign(numVertices * influencesPerVertex, 0.0f);
+
+	for (MeshBonesConstIterator i = mesh.bones.begin(); i != mesh.bones.end(); ++i) {
+		const MeshBone& bone = i->second;
+
+		typedef std::map<int, float>::const_iterator it_type;
+		for (it_type it = bone.weights.begin(); it != bone.weights.end(); ++it) {
+			size_t vertexId = it->first;
+			float weight = it->second;
+			if (vertexId >= numVertices || weight <= 0.0f) {
+				continue;
+			}
+
+			// Slots are kept sorted by descending weight, so the new influence is inserted
+			// in place and the lightest one falls off the end.
+			unsigned short* indices = &boneIndices[vertexId * influencesPerVertex];
+			float* weights = &boneWeights[vertexId * influencesPerVertex];
+			unsigned int slot = influencesPerVertex;
+			while (slot > 0 && weights[slot - 1] < weight) {
+				--slot;
+			}
+			if (slot == influencesPerVertex) {
+				continue;
+			}
+			for (unsigned int k = influencesPerVertex - 1; k > slot; --k) {
+				indices[k] = indices[k - 1];
+				weights[k] = weights[k - 1];
+			}
+			indices[slot] = (unsigned short)bone.index;
+			weights[slot] = weight;
+		}
+	}
+
+	for (size_t v = 0; v < numVertices; ++v) {
+		float* weights = &boneWeights[v * influencesPerVertex];
+		float total = 0.0f;
+		for (unsigned int k = 0; k < influencesPerVertex; ++k) {
+			total += weights[k];
+		}
+		if (total > 0.0f) {
+			for (unsigned int k = 0; k < influencesPerVertex; ++k) {
+				weights[k] /= total;
+			}
+		}
+	}
+}
+
+std::vector<float> flatten(const std::vector<aiVector3D>& vectors, size_t count, unsigned int components) {
+	std::vector<float> values;
+	values.reserve(count * components);
+	for (size_t i = 0; i < count && i < vectors.size(); ++i) {
+		for (unsigned int c = 0; c < components; ++c) {
+			values.push_back(vectors[i][c]);
+		}
+	}
+	return values;
+}
+
+std::vector<float> tangentsWithSign(const Mesh& mesh) {
+	std::vector<float> values;
+	values.reserve(mesh.tangent.size() * 4);
+	for (size_t v = 0; v < mesh.tangent.size(); ++v) {
+		values.push_back(mesh.tangent[v].x);
+		values.push_back(mesh.tangent[v].y);
+		values.push_back(mesh.tangent[v].z);
+		values.push_back(v < mesh.tangentSign.size() ? mesh.tangentSign[v] : 1.0f);
+	}
+	return values;
+}
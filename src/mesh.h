@@ -0,0 +1,101 @@
+#ifndef ASSIMP_TO_JSON_MESH_H
+#define ASSIMP_TO_JSON_MESH_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <assimp\scene.h>
+
+/*
+
+The converter's intermediate representation. populateMeshFromDae() fills a Mesh from the
+assimp scene and every writer (legacy three.js JSON, BufferGeometry, ...) reads from it.
+
+*/
+
+struct AnimationKeys {
+	std::vector<aiQuatKey> rotationKeys;
+	std::vector<aiVectorKey> positionKeys;
+	std::vector<aiVectorKey> scaleKeys;
+};
+
+struct MeshBone {
+	int index;
+	int pindex;
+	aiMatrix4x4 nodeTransform;
+	aiMatrix4x4 offsetMatrix;
+	std::string parentName;
+	std::map<int, float> weights;
+	std::map<std::string, AnimationKeys> animations;
+};
+
+struct AnimationInfo {
+	float length;
+	float fps;
+};
+
+// assimp's default when the source does not specify a frame rate.
+static const float defaultTicksPerSecond = 25.0f;
+
+// A blend shape from aiMesh::mAnimMeshes, with absolute positions (and normals, when the
+// source has them) for every vertex of the mesh.
+struct MorphTarget {
+	std::string name;
+	float weight;
+	std::vector<aiVector3D> vertex;
+	std::vector<aiVector3D> normal;
+};
+
+struct Mesh {
+	std::string name;
+	int numFaces;
+	std::vector<aiVector3D> vertex;
+	std::vector<aiVector3D> normal;
+	// Filled by generateTangents(); tangentSign is the bitangent handedness (+1/-1).
+	std::vector<aiVector3D> tangent;
+	std::vector<float> tangentSign;
+	std::vector<aiVector3D> uv;
+	std::vector<unsigned int> index;
+	std::vector<MorphTarget> morphTargets;
+	std::string diffuseMap;
+	std::string normalMap;
+	std::map< std::string, MeshBone > bones;
+	std::map< std::string, AnimationInfo > animations;
+
+	std::string error;
+};
+
+struct VertexBoneWeights {
+	std::vector<int> boneIds;
+	std::vector<float> boneWeights;
+};
+
+typedef std::map< std::string, MeshBone >::iterator MeshBonesIterator;
+typedef std::map< std::string, AnimationKeys >::iterator AnimationKeysIterator;
+typedef std::map< std::string, MeshBone >::const_iterator MeshBonesConstIterator;
+typedef std::map< std::string, AnimationInfo >::const_iterator AnimationInfoConstIterator;
+typedef std::map< std::string, AnimationKeys >::const_iterator AnimationKeysConstIterator;
+typedef std::map< int, VertexBoneWeights >::const_iterator VertexBoneWeightsConstIterator;
+
+// The first components of the first count vectors, back to back. Mesh::uv holds every UV
+// channel back to back, so flattening vertex.size() of them exports the first channel.
+std::vector<float> flatten(const std::vector<aiVector3D>& vectors, size_t count, unsigned int components);
+
+// Tangents as xyz plus handedness in w, the layout three.js and glTF expect.
+std::vector<float> tangentsWithSign(const Mesh& mesh);
+
+// Bones in MeshBone::index order, for stages that address bones by index (skin matrices,
+// glTF joints). Returns false, with the reason in error, when an index is out of range or
+// used by two bones, or a parent index is out of range.
+bool bonesByIndex(const Mesh& mesh, std::vector<const MeshBone*>& bones, std::string& error);
+
+// Skin influences per vertex in every exported format; three.js expects exactly four.
+static const unsigned int influencesPerVertex = 4;
+
+// Fills influencesPerVertex bone index/weight slots per vertex, keeping the heaviest bones
+// and renormalizing their weights to sum to one. Unused slots are bone 0 with weight 0.
+void collectSkinInfluences(const Mesh& mesh, unsigned int influencesPerVertex,
+	std::vector<unsigned short>& boneIndices, std::vector<float>& boneWeights);
+
+#endif
@@ -0,0 +1,239 @@
+#include <iostream>
+#include <utility>
+#include <algorithm>
+#include <cmath>
+
+#include "meshlets.h"
+#include "buffergeometry.h"
+#include "simd.h"
+#include "parallel.h"
+#include "allocationcounter.h"
+
+// Triangles handed to a worker at a time.
+static const size_t trianglesPerJob = 1 << 16;
+
+// Cones wider than this (minimum dot between the axis and a triangle normal) cannot be culled usefully.
+static const float minConeDot = 0.1f;
+
+static glm::simdVec4 loadVertex(const aiVector3D& v) {
+	return glm::simdVec4(v.x, v.y, v.z, 0.0f);
+}
+
+static void storeVector(float* out, const glm::simdVec4& v) {
+	glm::vec4 stored = glm::vec4_cast(v);
+	out[0] = stored.x;
+	out[1] = stored.y;
+	out[2] = stored.z;
+}
+
+// Buffers each worker reuses for every meshlet it builds.
+struct ClusterScratch {
+	std::vector<int> localIndex;             // mesh vertex -> index in the current meshlet, or -1
+	std::vector<glm::simdVec4> normals;      // unit normal of each triangle, zero when degenerate
+	std::vector<glm::simdVec4> corners;      // first corner of each triangle
+};
+
+static void computeBounds(const Mesh& mesh, const unsigned int* vertices, const unsigned char* triangles,
+	ClusterScratch& scratch, Meshlet& meshlet) {
+
+	glm::simdVec4 lo = loadVertex(mesh.vertex[vertices[0]]);
+	glm::simdVec4 hi = lo;
+	for (unsigned int i = 1; i < meshlet.vertexCount; ++i) {
+		glm::simdVec4 p = loadVertex(mesh.vertex[vertices[i]]);
+		lo = glm::min(lo, p);
+		hi = glm::max(hi, p);
+	}
+
+	glm::simdVec4 center = (lo + hi) * 0.5f;
+	float radius = 0.0f;
+	for (unsigned int i = 0; i < meshlet.vertexCount; ++i) {
+		radius = std::max(radius, glm::length(loadVertex(mesh.vertex[vertices[i]]) - center));
+	}
+	storeVector(meshlet.center, center);
+	meshlet.radius = radius;
+
+	// Cone axis is the average triangle normal; the cutoff comes from the widest deviation from it.
+	// Degenerate triangles keep a zero normal and are ignored.
+	std::vector<glm::simdVec4>& normals = scratch.normals;
+	std::vector<glm::simdVec4>& corners = scratch.corners;
+	normals.assign(meshlet.triangleCount, glm::simdVec4(0.0f));
+	corners.resize(meshlet.triangleCount);
+	glm::simdVec4 axis(0.0f);
+	for (unsigned int t = 0; t < meshlet.triangleCount; ++t) {
+		glm::simdVec4 a = loadVertex(mesh.vertex[vertices[triangles[t * 3 + 0]]]);
+		glm::simdVec4 b = loadVertex(mesh.vertex[vertices[triangles[t * 3 + 1]]]);
+		glm::simdVec4 c = loadVertex(mesh.vertex[vertices[triangles[t * 3 + 2]]]);
+		glm::simdVec4 n = glm::cross(b - a, c - a);
+		float area = glm::length(n);
+		corners[t] = a;
+		if (area > 0.0f) {
+			normals[t] = n * (1.0f / area);
+			axis = axis + normals[t];
+		}
+	}
+
+	float axisLength = glm::length(axis);
+	float minDot = 1.0f;
+	if (axisLength > 0.0f) {
+		axis = axis * (1.0f / axisLength);
+		for (unsigned int t = 0; t < meshlet.triangleCount; ++t) {
+			float d = glm::dot(axis, normals[t]);
+			if (glm::dot(normals[t], normals[t]) > 0.0f) {
+				minDot = std::min(minDot, d);
+			}
+		}
+	}
+
+	if (axisLength == 0.0f || minDot <= minConeDot) {
+		storeVector(meshlet.coneApex, center);
+		storeVector(meshlet.coneAxis, axisLength > 0.0f ? axis : glm::simdVec4(0.0f, 0.0f, 1.0f, 0.0f));
+		meshlet.coneCutoff = 1.0f;
+		return;
+	}
+
+	// Move the apex back along the axis until every triangle plane is in front of it.
+	float maxT = 0.0f;
+	for (unsigned int t = 0; t < meshlet.triangleCount; ++t) {
+		float dn = glm::dot(axis, normals[t]);
+		if (dn > 0.0f) {
+			maxT = std::max(maxT, glm::dot(center - corners[t], normals[t]) / dn);
+		}
+	}
+
+	storeVector(meshlet.coneApex, center - axis * maxT);
+	storeVector(meshlet.coneAxis, axis);
+	meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+// Greedily clusters triangles [firstTriangle, lastTriangle) in index order.
+static void clusterJob(const Mesh& mesh, const MeshletOptions& options, size_t firstTriangle, size_t lastTriangle,
+	ClusterScratch& scratch, Meshlets& out) {
+
+	std::vector<int>& localIndex = scratch.localIndex;
+	Meshlet current = Meshlet();
+	for (size_t t = firstTriangle; t <= lastTriangle; ++t) {
+		const unsigned int* triangle = t < lastTriangle ? &mesh.index[t * 3] : NULL;
+
+		unsigned int newVertices = 0;
+		if (triangle) {
+			for (unsigned int k = 0; k < 3; ++k) {
+				newVertices += localIndex[triangle[k]] < 0;
+			}
+		}
+
+		bool full = current.vertexCount + newVertices > options.maxVertices || current.triangleCount + 1 > options.maxTriangles;
+		if ((!triangle || full) && current.triangleCount > 0) {
+			computeBounds(mesh, &out.vertices[current.vertexOffset], &out.triangles[current.triangleOffset * 3], scratch, current);
+			for (unsigned int i = 0; i < current.vertexCount; ++i) {
+				localIndex[out.vertices[current.vertexOffset + i]] = -1;
+			}
+			out.meshlets.push_back(current);
+
+			current = Meshlet();
+			current.vertexOffset = out.vertices.size();
+			current.triangleOffset = out.triangles.size() / 3;
+		}
+		if (!triangle) {
+			break;
+		}
+
+		for (unsigned int k = 0; k < 3; ++k) {
+			int& local = localIndex[triangle[k]];
+			if (local < 0) {
+				local = current.vertexCount++;
+				out.vertices.push_back(triangle[k]);
+			}
+			out.triangles.push_back((unsigned char)local);
+		}
+		++current.triangleCount;
+	}
+}
+
+namespace {
+
+// Clusters one trianglesPerJob range per index. Each thread's copy sets up its scratch
+// buffers on its first job and reuses them for the rest.
+struct ClusterJob {
+	const Mesh* mesh;
+	const MeshletOptions* options;
+	Meshlets* jobs;
+	ClusterScratch scratch;
+
+	void operator()(size_t first, size_t last) {
+		size_t numTriangles = mesh->index.size() / 3;
+		if (scratch.localIndex.empty()) {
+			scratch.localIndex.assign(mesh->vertex.size(), -1);
+		}
+		for (size_t job = first; job < last; ++job) {
+			size_t firstTriangle = job * trianglesPerJob;
+			clusterJob(*mesh, *options, firstTriangle, std::min(firstTriangle + trianglesPerJob, numTriangles), scratch, jobs[job]);
+		}
+	}
+};
+
+}
+
+Meshlets buildMeshlets(const Mesh& mesh, const MeshletOptions& requestedOptions) {
+	StageAllocations stageAllocations("buildMeshlets");
+	std::cout << "\n\nBuilding meshlets.";
+
+	MeshletOptions options = requestedOptions;
+	options.maxVertices = std::min(std::max(options.maxVertices, 3u), 256u);
+	options.maxTriangles = std::max(options.maxTriangles, 1u);
+
+	size_t numTriangles = mesh.index.size() / 3;
+	size_t numJobs = (numTriangles + trianglesPerJob - 1) / trianglesPerJob;
+	std::vector<Meshlets> jobs(numJobs);
+
+	ClusterJob job;
+	job.mesh = &mesh;
+	job.options = &options;
+	job.jobs = jobs.empty() ? 0 : &jobs[0];
+	parallelFor(numJobs, 1, options.threadCount, job);
+
+	Meshlets meshlets;
+	for (size_t job = 0; job < numJobs; ++job) {
+		unsigned int vertexBase = meshlets.vertices.size();
+		unsigned int triangleBase = meshlets.triangles.size() / 3;
+		for (size_t i = 0; i < jobs[job].meshlets.size(); ++i) {
+			Meshlet meshlet = jobs[job].meshlets[i];
+			meshlet.vertexOffset += vertexBase;
+			meshlet.triangleOffset += triangleBase;
+			meshlets.meshlets.push_back(meshlet);
+		}
+		meshlets.vertices.insert(meshlets.vertices.end(), jobs[job].vertices.begin(), jobs[job].vertices.end());
+		meshlets.triangles.insert(meshlets.triangles.end(), jobs[job].triangles.begin(), jobs[job].triangles.end());
+	}
+
+	std::cout << "\nNum Meshlets: " << meshlets.meshlets.size();
+	return meshlets;
+}
+
+Json::Value meshletsToJson(const Meshlets& meshlets, const MeshletOptions& options, bool base64) {
+	std::vector<unsigned int> ranges;
+	std::vector<float> bounds;
+	ranges.reserve(meshlets.meshlets.size() * 4);
+	bounds.reserve(meshlets.meshlets.size() * 12);
+	for (size_t i = 0; i < meshlets.meshlets.size(); ++i) {
+		const Meshlet& meshlet = meshlets.meshlets[i];
+		ranges.push_back(meshlet.vertexOffset);
+		ranges.push_back(meshlet.vertexCount);
+		ranges.push_back(meshlet.triangleOffset);
+		ranges.push_back(meshlet.triangleCount);
+
+		bounds.insert(bounds.end(), meshlet.center, meshlet.center + 3);
+		bounds.push_back(meshlet.radius);
+		bounds.insert(bounds.end(), meshlet.coneApex, meshlet.coneApex + 3);
+		bounds.insert(bounds.end(), meshlet.coneAxis, meshlet.coneAxis + 3);
+		bounds.push_back(meshlet.coneCutoff);
+	}
+
+	Json::Value root;
+	root["maxVertices"] = options.maxVertices;
+	root["maxTriangles"] = options.maxTriangles;
+	root.emplace("ranges", typedArrayToJson("Uint32Array", 4, ranges, base64));
+	root.emplace("bounds", typedArrayToJson("Float32Array", 12, bounds, base64));
+	root.emplace("vertices", typedArrayToJson("Uint32Array", 1, meshlets.vertices, base64));
+	root.emplace("triangles", typedArrayToJson("Uint8Array", 3, meshlets.triangles, base64));
+	return root;
+}
@@ -0,0 +1,68 @@
+#ifndef ASSIMP_TO_JSON_MESHLETS_H
+#define ASSIMP_TO_JSON_MESHLETS_H
+
+#include <vector>
+
+#include <json\json.h>
+
+#include "mesh.h"
+
+/*
+
+Splits Mesh::index into meshlets, small clusters that the client can cull before
+drawing. No meshlet uses more than maxVertices unique vertices or maxTriangles triangles.
+
+Each meshlet gets:
+	- a bounding sphere (center, radius)
+	- a normal cone (apex, axis, cutoff). The meshlet is backfacing and can be skipped
+	  when dot(normalize(apex - cameraPosition), axis) >= cutoff. A cutoff of 1 means
+	  the triangles face too many directions to cull.
+
+The triangle list is cut into fixed-size jobs, and worker threads cluster the jobs
+independently. The output therefore does not depend on the number of threads. Only the
+last meshlet of each job can be underfull.
+
+*/
+
+struct MeshletOptions {
+	MeshletOptions() : maxVertices(64), maxTriangles(124), threadCount(0) {}
+
+	// maxVertices is clamped to 256 because triangles store 8-bit local indices.
+	unsigned int maxVertices;
+	unsigned int maxTriangles;
+	// 0 uses std::thread::hardware_concurrency().
+	unsigned int threadCount;
+};
+
+struct Meshlet {
+	// Offset/count into Meshlets::vertices.
+	unsigned int vertexOffset;
+	unsigned int vertexCount;
+	// Offset into Meshlets::triangles in triangles (three local indices each).
+	unsigned int triangleOffset;
+	unsigned int triangleCount;
+
+	float center[3];
+	float radius;
+	float coneApex[3];
+	float coneAxis[3];
+	float coneCutoff;
+};
+
+struct Meshlets {
+	std::vector<Meshlet> meshlets;
+	// Mesh vertex indices referenced by each meshlet.
+	std::vector<unsigned int> vertices;
+	// Three indices per triangle, local to the owning meshlet's vertex range.
+	std::vector<unsigned char> triangles;
+};
+
+Meshlets buildMeshlets(const Mesh& mesh, const MeshletOptions& options);
+
+// Typed arrays in the BufferGeometry attribute form (see typedArrayToJson):
+// "ranges" (Uint32Array) holds vertexOffset, vertexCount, triangleOffset and triangleCount for every meshlet.
+// "bounds" (Float32Array) holds center (3), radius, coneApex (3), coneAxis (3) and coneCutoff for every meshlet.
+// "vertices" is a Uint32Array and "triangles" a Uint8Array of local indices.
+Json::Value meshletsToJson(const Meshlets& meshlets, const MeshletOptions& options, bool base64);
+
+#endif
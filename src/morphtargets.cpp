@@ -0,0 +1,126 @@
+#include <iostream>
+#include <algorithm>
+#include <utility>
+#include <cmath>
+#include <cfloat>
+
+#include "morphtargets.h"
+#include "buffergeometry.h"
+#include "indexsplit.h"
+#include "parallel.h"
+#include "allocationcounter.h"
+
+namespace {
+
+struct SparseTargetJob {
+	const Mesh* mesh;
+	float epsilon;
+	float normalEpsilon;
+	SparseMorphTarget* targets;
+
+	void operator()(size_t first, size_t last) const {
+		for (size_t t = first; t < last; ++t) {
+			build(mesh->morphTargets[t], targets[t]);
+		}
+	}
+
+	void build(const MorphTarget& source, SparseMorphTarget& target) const {
+		size_t numVertices = mesh->vertex.size();
+		bool hasNormals = !source.normal.empty() && !mesh->normal.empty();
+
+		target.name = source.name;
+		target.weight = source.weight;
+		float maxDelta = 0.0f;
+		for (size_t v = 0; v < numVertices; ++v) {
+			aiVector3D delta = source.vertex[v] - mesh->vertex[v];
+			bool moved = delta.Length() > epsilon;
+			if (!moved && hasNormals) {
+				moved = (source.normal[v] - mesh->normal[v]).Length() > normalEpsilon;
+			}
+			if (moved) {
+				target.indices.push_back(v);
+				maxDelta = std::max(maxDelta, std::max(std::fabs(delta.x), std::max(std::fabs(delta.y), std::fabs(delta.z))));
+			}
+		}
+
+		target.positionScale = maxDelta > 0.0f ? maxDelta / 32767.0f : 0.0f;
+		float inverseScale = maxDelta > 0.0f ? 32767.0f / maxDelta : 0.0f;
+		target.positions.reserve(target.indices.size() * 3);
+		if (hasNormals) {
+			target.normals.reserve(target.indices.size() * 3);
+		}
+		for (size_t i = 0; i < target.indices.size(); ++i) {
+			unsigned int v = target.indices[i];
+			aiVector3D delta = source.vertex[v] - mesh->vertex[v];
+			for (unsigned int c = 0; c < 3; ++c) {
+				target.positions.push_back((short)std::floor(delta[c] * inverseScale + 0.5f));
+			}
+			if (hasNormals) {
+				aiVector3D normalDelta = source.normal[v] - mesh->normal[v];
+				for (unsigned int c = 0; c < 3; ++c) {
+					float q = std::floor(std::min(std::max(normalDelta[c] * 0.5f, -1.0f), 1.0f) * 127.0f + 0.5f);
+					target.normals.push_back((signed char)q);
+				}
+			}
+		}
+
+		size_t indexSize = fitsInUnsignedShort(target.indices) ? 2 : 4;
+		target.denseBytes = numVertices * 3 * sizeof(float) * (hasNormals ? 2 : 1);
+		target.sparseBytes = target.indices.size() * indexSize
+			+ target.positions.size() * sizeof(short) + target.normals.size();
+	}
+};
+
+}
+
+std::vector<SparseMorphTarget> buildMorphTargets(const Mesh& mesh, const MorphTargetOptions& options) {
+	StageAllocations stageAllocations("buildMorphTargets");
+	std::vector<SparseMorphTarget> targets(mesh.morphTargets.size());
+	if (targets.empty() || mesh.vertex.empty()) {
+		return targets;
+	}
+	std::cout << "\n\nBuilding sparse morph targets.";
+
+	float lo[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float hi[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (size_t v = 0; v < mesh.vertex.size(); ++v) {
+		for (unsigned int c = 0; c < 3; ++c) {
+			lo[c] = std::min(lo[c], mesh.vertex[v][c]);
+			hi[c] = std::max(hi[c], mesh.vertex[v][c]);
+		}
+	}
+	float diagonal = std::sqrt((hi[0] - lo[0]) * (hi[0] - lo[0]) + (hi[1] - lo[1]) * (hi[1] - lo[1]) + (hi[2] - lo[2]) * (hi[2] - lo[2]));
+
+	SparseTargetJob job = { &mesh, options.epsilon * diagonal, options.normalEpsilon, &targets[0] };
+	parallelFor(targets.size(), 1, options.threadCount, job);
+
+	size_t denseBytes = 0, sparseBytes = 0;
+	for (size_t t = 0; t < targets.size(); ++t) {
+		const SparseMorphTarget& target = targets[t];
+		std::cout << "\n    " << target.name << ": " << target.indices.size() << " of " << mesh.vertex.size()
+			<< " vertices, " << target.sparseBytes << " bytes (dense " << target.denseBytes << ")";
+		denseBytes += target.denseBytes;
+		sparseBytes += target.sparseBytes;
+	}
+	std::cout << "\nMorph targets: " << sparseBytes << " bytes sparse, " << denseBytes << " bytes dense.";
+	return targets;
+}
+
+Json::Value morphTargetsToJson(const std::vector<SparseMorphTarget>& targets, bool base64) {
+	Json::Value root = Json::Value(Json::arrayValue);
+	for (size_t i = 0; i < targets.size(); ++i) {
+		const SparseMorphTarget& target = targets[i];
+		Json::Value json;
+		json["name"] = target.name;
+		json["weight"] = target.weight;
+		json["count"] = (Json::UInt)target.indices.size();
+		json["positionScale"] = target.positionScale;
+		json.emplace("indices", indexArrayToJson(target.indices, base64));
+		json.emplace("positions", typedArrayToJson("Int16Array", 3, target.positions, base64));
+		if (!target.normals.empty()) {
+			json.emplace("normals", typedArrayToJson("Int8Array", 3, target.normals, base64));
+		}
+		root.append(std::move(json));
+	}
+	return root;
+}
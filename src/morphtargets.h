@@ -0,0 +1,54 @@
+#ifndef ASSIMP_TO_JSON_MORPH_TARGETS_H
+#define ASSIMP_TO_JSON_MORPH_TARGETS_H
+
+#include <string>
+#include <vector>
+
+#include <json\json.h>
+
+#include "mesh.h"
+
+/*
+
+Morph targets (blend shapes) stored sparsely. A target keeps only the vertices it moves,
+since most touch a small part of the mesh.
+
+A vertex is kept when its position moves more than epsilon, relative to the mesh bounding
+box diagonal, or its normal changes by more than normalEpsilon. Kept position deltas are
+16-bit signed values over the target's largest delta:
+	delta = q * positionScale
+Normal deltas (when the source has target normals) are 8-bit signed values:
+	delta = q / 127 * 2
+Targets are processed in parallel on up to threadCount threads.
+
+Dense size is a float32 xyz per vertex (plus a normal); sparse size is the kept indices
+(16 or 32-bit) plus their quantized deltas. Both are reported per target.
+
+*/
+
+struct MorphTargetOptions {
+	MorphTargetOptions() : epsilon(1e-4f), normalEpsilon(1e-3f), threadCount(0) {}
+
+	float epsilon;
+	float normalEpsilon;
+	// 0 uses std::thread::hardware_concurrency().
+	unsigned int threadCount;
+};
+
+struct SparseMorphTarget {
+	std::string name;
+	float weight;
+	std::vector<unsigned int> indices;
+	float positionScale;
+	// 3 per index.
+	std::vector<short> positions;
+	std::vector<signed char> normals;
+	size_t denseBytes;
+	size_t sparseBytes;
+};
+
+std::vector<SparseMorphTarget> buildMorphTargets(const Mesh& mesh, const MorphTargetOptions& options);
+
+Json::Value morphTargetsToJson(const std::vector<SparseMorphTarget>& targets, bool base64);
+
+#endif
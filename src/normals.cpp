@@ -0,0 +1,363 @@
+#include <iostream>
+#include <algorithm>
+#include <utility>
+#include <cmath>
+
+#include "normals.h"
+#include "parallel.h"
+#include "simd.h"
+#include "allocationcounter.h"
+
+static const size_t trianglesPerJob = 1 << 14;
+static const size_t verticesPerJob = 1 << 12;
+static const float pi = 3.14159265358979f;
+
+// Corners with normals closer than this share a vertex.
+static const float sameNormalDot = 0.9999f;
+
+static glm::simdVec4 load(const aiVector3D& v) {
+	return glm::simdVec4(v.x, v.y, v.z, 0.0f);
+}
+
+static aiVector3D store(const glm::simdVec4& v) {
+	glm::vec4 stored = glm::vec4_cast(v);
+	return aiVector3D(stored.x, stored.y, stored.z);
+}
+
+static glm::simdVec4 normalizeOr(const glm::simdVec4& v, const glm::simdVec4& fallback) {
+	float length = glm::length(v);
+	return length > 0.0f ? v * (1.0f / length) : fallback;
+}
+
+static float cornerAngle(const glm::simdVec4& corner, const glm::simdVec4& a, const glm::simdVec4& b) {
+	glm::simdVec4 e1 = normalizeOr(a - corner, glm::simdVec4(0.0f));
+	glm::simdVec4 e2 = normalizeOr(b - corner, glm::simdVec4(0.0f));
+	return std::acos(std::max(-1.0f, std::min(1.0f, glm::dot(e1, e2))));
+}
+
+namespace {
+
+// Unit face normals plus the weight each face contributes at each of its corners.
+struct FaceNormalJob {
+	const Mesh* mesh;
+	bool angleWeighted;
+	glm::simdVec4* faceNormals;
+	float* cornerWeights;
+
+	void operator()(size_t first, size_t last) const {
+		for (size_t t = first; t < last; ++t) {
+			glm::simdVec4 p[3];
+			for (unsigned int k = 0; k < 3; ++k) {
+				p[k] = load(mesh->vertex[mesh->index[t * 3 + k]]);
+			}
+			glm::simdVec4 n = glm::cross(p[1] - p[0], p[2] - p[0]);
+			float doubleArea = glm::length(n);
+			faceNormals[t] = doubleArea > 0.0f ? n * (1.0f / doubleArea) : glm::simdVec4(0.0f);
+			for (unsigned int k = 0; k < 3; ++k) {
+				cornerWeights[t * 3 + k] = angleWeighted
+					? cornerAngle(p[k], p[(k + 1) % 3], p[(k + 2) % 3])
+					: doubleArea * 0.5f;
+			}
+		}
+	}
+};
+
+// Smooth normal of every corner: the weighted sum of the faces around its position that
+// are within the crease angle of the corner's own face.
+struct CornerNormalJob {
+	const Mesh* mesh;
+	const unsigned int* vertexPosition;
+	const unsigned int* positionOffsets;
+	const unsigned int* positionCorners;
+	const glm::simdVec4* faceNormals;
+	const float* cornerWeights;
+	float cosCrease;
+	glm::simdVec4* cornerNormals;
+
+	void operator()(size_t first, size_t last) const {
+		for (size_t t = first; t < last; ++t) {
+			const glm::simdVec4& own = faceNormals[t];
+			// A degenerate face has no direction of its own and takes the smooth normal.
+			bool degenerate = glm::dot(own, own) == 0.0f;
+			for (unsigned int k = 0; k < 3; ++k) {
+				unsigned int position = vertexPosition[mesh->index[t * 3 + k]];
+				glm::simdVec4 sum(0.0f);
+				for (unsigned int i = positionOffsets[position]; i < positionOffsets[position + 1]; ++i) {
+					unsigned int corner = positionCorners[i];
+					const glm::simdVec4& other = faceNormals[corner / 3];
+					if (degenerate || corner / 3 == t || glm::dot(own, other) >= cosCrease) {
+						sum = sum + other * cornerWeights[corner];
+					}
+				}
+				cornerNormals[t * 3 + k] = normalizeOr(sum, own);
+			}
+		}
+	}
+};
+
+}
+
+// Maps every vertex to an id shared by all vertices with the same position.
+static std::vector<unsigned int> weldPositions(const Mesh& mesh, unsigned int& numPositions) {
+	struct PositionLess {
+		const std::vector<aiVector3D>* vertex;
+		bool operator()(unsigned int a, unsigned int b) const {
+			const aiVector3D& p = (*vertex)[a];
+			const aiVector3D& q = (*vertex)[b];
+			if (p.x != q.x) return p.x < q.x;
+			if (p.y != q.y) return p.y < q.y;
+			return p.z < q.z;
+		}
+	};
+
+	size_t numVertices = mesh.vertex.size();
+	std::vector<unsigned int> order(numVertices);
+	for (size_t v = 0; v < numVertices; ++v) {
+		order[v] = v;
+	}
+	PositionLess less = { &mesh.vertex };
+	std::sort(order.begin(), order.end(), less);
+
+	std::vector<unsigned int> position(numVertices);
+	numPositions = 0;
+	for (size_t i = 0; i < numVertices; ++i) {
+		if (i > 0 && !(mesh.vertex[order[i]] == mesh.vertex[order[i - 1]])) {
+			++numPositions;
+		}
+		position[order[i]] = numPositions;
+	}
+	if (numVertices > 0) {
+		++numPositions;
+	}
+	return position;
+}
+
+// Appends a copy of vertex source (position, UVs of every channel, bone weights).
+static unsigned int cloneVertex(Mesh& mesh, unsigned int source,
+	const std::vector< std::vector< std::pair<MeshBone*, float> > >& influences) {
+
+	unsigned int clone = mesh.vertex.size();
+	mesh.vertex.push_back(mesh.vertex[source]);
+	for (size_t i = 0; i < mesh.morphTargets.size(); ++i) {
+		MorphTarget& target = mesh.morphTargets[i];
+		target.vertex.push_back(target.vertex[source]);
+		if (!target.normal.empty()) {
+			target.normal.push_back(target.normal[source]);
+		}
+	}
+	for (size_t i = 0; i < influences[source].size(); ++i) {
+		influences[source][i].first->weights[clone] = influences[source][i].second;
+	}
+	return clone;
+}
+
+void generateNormals(Mesh& mesh, const NormalOptions& options) {
+	StageAllocations stageAllocations("generateNormals");
+	std::cout << "\n\nGenerating normals.";
+
+	size_t numVertices = mesh.vertex.size();
+	size_t numTriangles = mesh.index.size() / 3;
+	if (numVertices == 0 || numTriangles == 0) {
+		return;
+	}
+
+	std::vector<glm::simdVec4> faceNormals(numTriangles);
+	std::vector<float> cornerWeights(numTriangles * 3);
+	FaceNormalJob faceJob = { &mesh, options.angleWeighted, &faceNormals[0], &cornerWeights[0] };
+	parallelFor(numTriangles, trianglesPerJob, options.threadCount, faceJob);
+
+	// position -> corners
+	unsigned int numPositions = 0;
+	std::vector<unsigned int> vertexPosition = weldPositions(mesh, numPositions);
+	std::vector<unsigned int> positionOffsets(numPositions + 1, 0);
+	for (size_t c = 0; c < numTriangles * 3; ++c) {
+		++positionOffsets[vertexPosition[mesh.index[c]] + 1];
+	}
+	for (unsigned int p = 0; p < numPositions; ++p) {
+		positionOffsets[p + 1] += positionOffsets[p];
+	}
+	std::vector<unsigned int> positionCorners(numTriangles * 3);
+	std::vector<unsigned int> fill(positionOffsets.begin(), positionOffsets.end() - 1);
+	for (size_t c = 0; c < numTriangles * 3; ++c) {
+		positionCorners[fill[vertexPosition[mesh.index[c]]]++] = c;
+	}
+
+	std::vector<glm::simdVec4> cornerNormals(numTriangles * 3);
+	CornerNormalJob cornerJob = {
+		&mesh, &vertexPosition[0], &positionOffsets[0], &positionCorners[0],
+		&faceNormals[0], &cornerWeights[0], std::cos(options.creaseAngle * pi / 180.0f), &cornerNormals[0]
+	};
+	parallelFor(numTriangles, trianglesPerJob, options.threadCount, cornerJob);
+
+	// Bone weights per vertex, so split vertices can copy them.
+	std::vector< std::vector< std::pair<MeshBone*, float> > > influences(numVertices);
+	for (MeshBonesIterator i = mesh.bones.begin(); i != mesh.bones.end(); ++i) {
+		typedef std::map<int, float>::const_iterator it_type;
+		for (it_type it = i->second.weights.begin(); it != i->second.weights.end(); ++it) {
+			if (it->first >= 0 && size_t(it->first) < numVertices) {
+				influences[it->first].push_back(std::make_pair(&i->second, it->second));
+			}
+		}
+	}
+
+	// Give every corner a vertex with its normal; variants of a vertex are chained through next.
+	std::vector<glm::simdVec4> normals(numVertices, glm::simdVec4(0.0f, 0.0f, 1.0f, 0.0f));
+	std::vector<bool> assigned(numVertices, false);
+	std::vector<int> next(numVertices, -1);
+	std::vector<unsigned int> source;
+	size_t splits = 0;
+	for (size_t c = 0; c < numTriangles * 3; ++c) {
+		unsigned int v = mesh.index[c];
+		const glm::simdVec4& n = cornerNormals[c];
+		if (!assigned[v]) {
+			normals[v] = n;
+			assigned[v] = true;
+			continue;
+		}
+
+		unsigned int u = v;
+		while (glm::dot(normals[u], n) < sameNormalDot) {
+			if (next[u] >= 0) {
+				u = next[u];
+				continue;
+			}
+			unsigned int clone = cloneVertex(mesh, v, influences);
+			source.push_back(v);
+			normals.push_back(n);
+			next.push_back(-1);
+			next[u] = clone;
+			u = clone;
+			++splits;
+		}
+		mesh.index[c] = u;
+	}
+
+	// Every UV channel is stored back to back, so the channels are rebuilt around the new vertices.
+	if (!source.empty() && mesh.uv.size() >= numVertices) {
+		size_t channels = mesh.uv.size() / numVertices;
+		std::vector<aiVector3D> uv;
+		uv.reserve(channels * mesh.vertex.size());
+		for (size_t channel = 0; channel < channels; ++channel) {
+			const aiVector3D* original = &mesh.uv[channel * numVertices];
+			uv.insert(uv.end(), original, original + numVertices);
+			for (size_t i = 0; i < source.size(); ++i) {
+				uv.push_back(original[source[i]]);
+			}
+		}
+		mesh.uv.swap(uv);
+	}
+
+	mesh.normal.resize(mesh.vertex.size());
+	for (size_t v = 0; v < mesh.vertex.size(); ++v) {
+		mesh.normal[v] = store(normals[v]);
+	}
+
+	std::cout << "\nSplit " << splits << " vertices along creases.";
+}
+
+namespace {
+
+// Per-corner UV tangent and bitangent of the corner's face, weighted by the corner angle.
+struct CornerTangentJob {
+	const Mesh* mesh;
+	glm::simdVec4* cornerTangents;
+	glm::simdVec4* cornerBitangents;
+
+	void operator()(size_t first, size_t last) const {
+		for (size_t t = first; t < last; ++t) {
+			glm::simdVec4 p[3];
+			aiVector3D uv[3];
+			for (unsigned int k = 0; k < 3; ++k) {
+				unsigned int v = mesh->index[t * 3 + k];
+				p[k] = load(mesh->vertex[v]);
+				uv[k] = mesh->uv[v];
+			}
+
+			glm::simdVec4 e1 = p[1] - p[0], e2 = p[2] - p[0];
+			float du1 = uv[1].x - uv[0].x, dv1 = uv[1].y - uv[0].y;
+			float du2 = uv[2].x - uv[0].x, dv2 = uv[2].y - uv[0].y;
+			float determinant = du1 * dv2 - du2 * dv1;
+
+			glm::simdVec4 tangent(0.0f), bitangent(0.0f);
+			if (determinant != 0.0f) {
+				float r = 1.0f / determinant;
+				tangent = normalizeOr((e1 * dv2 - e2 * dv1) * r, glm::simdVec4(0.0f));
+				bitangent = normalizeOr((e2 * du1 - e1 * du2) * r, glm::simdVec4(0.0f));
+			}
+
+			for (unsigned int k = 0; k < 3; ++k) {
+				float angle = cornerAngle(p[k], p[(k + 1) % 3], p[(k + 2) % 3]);
+				cornerTangents[t * 3 + k] = tangent * angle;
+				cornerBitangents[t * 3 + k] = bitangent * angle;
+			}
+		}
+	}
+};
+
+// Sums the corners of each vertex and orthogonalizes against its normal.
+struct VertexTangentJob {
+	Mesh* mesh;
+	const unsigned int* vertexOffsets;
+	const unsigned int* vertexCorners;
+	const glm::simdVec4* cornerTangents;
+	const glm::simdVec4* cornerBitangents;
+
+	void operator()(size_t first, size_t last) const {
+		for (size_t v = first; v < last; ++v) {
+			glm::simdVec4 tangent(0.0f), bitangent(0.0f);
+			for (unsigned int i = vertexOffsets[v]; i < vertexOffsets[v + 1]; ++i) {
+				tangent = tangent + cornerTangents[vertexCorners[i]];
+				bitangent = bitangent + cornerBitangents[vertexCorners[i]];
+			}
+
+			glm::simdVec4 normal = load(mesh->normal[v]);
+			tangent = tangent - normal * glm::dot(normal, tangent);
+			// Any perpendicular direction will do when the UVs give none.
+			glm::simdVec4 fallback = std::fabs(mesh->normal[v].x) < 0.9f
+				? glm::cross(normal, glm::simdVec4(1.0f, 0.0f, 0.0f, 0.0f))
+				: glm::cross(normal, glm::simdVec4(0.0f, 1.0f, 0.0f, 0.0f));
+			tangent = normalizeOr(tangent, normalizeOr(fallback, glm::simdVec4(1.0f, 0.0f, 0.0f, 0.0f)));
+
+			mesh->tangent[v] = store(tangent);
+			mesh->tangentSign[v] = glm::dot(glm::cross(normal, tangent), bitangent) < 0.0f ? -1.0f : 1.0f;
+		}
+	}
+};
+
+}
+
+void generateTangents(Mesh& mesh, unsigned int threadCount) {
+	StageAllocations stageAllocations("generateTangents");
+	std::cout << "\n\nGenerating tangents.";
+
+	size_t numVertices = mesh.vertex.size();
+	size_t numTriangles = mesh.index.size() / 3;
+	if (numTriangles == 0 || mesh.normal.size() < numVertices || mesh.uv.size() < numVertices) {
+		std::cout << "\nTangents need normals and UVs; skipped.";
+		return;
+	}
+
+	std::vector<glm::simdVec4> cornerTangents(numTriangles * 3);
+	std::vector<glm::simdVec4> cornerBitangents(numTriangles * 3);
+	CornerTangentJob cornerJob = { &mesh, &cornerTangents[0], &cornerBitangents[0] };
+	parallelFor(numTriangles, trianglesPerJob, threadCount, cornerJob);
+
+	// vertex -> corners
+	std::vector<unsigned int> vertexOffsets(numVertices + 1, 0);
+	for (size_t c = 0; c < numTriangles * 3; ++c) {
+		++vertexOffsets[mesh.index[c] + 1];
+	}
+	for (size_t v = 0; v < numVertices; ++v) {
+		vertexOffsets[v + 1] += vertexOffsets[v];
+	}
+	std::vector<unsigned int> vertexCorners(numTriangles * 3);
+	std::vector<unsigned int> fill(vertexOffsets.begin(), vertexOffsets.end() - 1);
+	for (size_t c = 0; c < numTriangles * 3; ++c) {
+		vertexCorners[fill[mesh.index[c]]++] = c;
+	}
+
+	mesh.tangent.resize(numVertices);
+	mesh.tangentSign.resize(numVertices);
+	VertexTangentJob vertexJob = { &mesh, &vertexOffsets[0], &vertexCorners[0], &cornerTangents[0], &cornerBitangents[0] };
+	parallelFor(numVertices, verticesPerJob, threadCount, vertexJob);
+}
@@ -0,0 +1,41 @@
+#ifndef ASSIMP_TO_JSON_NORMALS_H
+#define ASSIMP_TO_JSON_NORMALS_H
+
+#include "mesh.h"
+
+/*
+
+Normal and tangent generation for sources that do not provide them.
+
+generateNormals() smooths across every face sharing a vertex position, unless the angle
+between two face normals exceeds creaseAngle. Faces are weighted by their corner angle
+(or by their area). A vertex whose corners end up with different normals is split, and
+the copies keep its UVs and bone weights. The writers pick the index width afterwards, so
+splitting may take the mesh past 65,535 vertices.
+
+generateTangents() follows the MikkTSpace conventions. Per-face UV derivative tangents are
+angle-weighted onto the vertices and Gram-Schmidt orthogonalized against the normal.
+The sign of the bitangent is stored separately. Unlike full MikkTSpace, it does not
+split vertices whose tangent frames disagree; seams the source already split keep
+separate frames.
+
+Face and corner work is split into triangle ranges and run on threadCount threads, with
+simdVec4 accumulation.
+
+*/
+
+struct NormalOptions {
+	NormalOptions() : creaseAngle(60.0f), angleWeighted(true), threadCount(0) {}
+
+	// Degrees.
+	float creaseAngle;
+	bool angleWeighted;
+	// 0 uses std::thread::hardware_concurrency().
+	unsigned int threadCount;
+};
+
+void generateNormals(Mesh& mesh, const NormalOptions& options);
+
+void generateTangents(Mesh& mesh, unsigned int threadCount);
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef ASSIMP_TO_JSON_PARALLEL_H
+#define ASSIMP_TO_JSON_PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace ParallelDetail {
+	template <typename Function>
+	void worker(size_t count, size_t chunkSize, Function function, std::atomic<size_t>* next) {
+		for (size_t chunk = (*next)++; chunk * chunkSize < count; chunk = (*next)++) {
+			function(chunk * chunkSize, std::min(count, (chunk + 1) * chunkSize));
+		}
+	}
+}
+
+// Calls function(first, last) for chunkSize ranges covering [0, count), spread over up to
+// threadCount threads (0 means hardware_concurrency). The calling thread is one of them.
+// Each thread calls its own copy of function, so a functor can keep scratch buffers that
+// it reuses across the chunks that thread takes.
+template <typename Function>
+void parallelFor(size_t count, size_t chunkSize, unsigned int threadCount, Function function) {
+	if (threadCount == 0) {
+		threadCount = std::thread::hardware_concurrency();
+	}
+	size_t chunks = (count + chunkSize - 1) / chunkSize;
+	threadCount = (unsigned int)std::max<size_t>(1, std::min<size_t>(threadCount, chunks));
+
+	std::atomic<size_t> next(0);
+	std::vector<std::thread> threads;
+	for (unsigned int i = 1; i < threadCount; ++i) {
+		threads.push_back(std::thread(ParallelDetail::worker<Function>, count, chunkSize, function, &next));
+	}
+	ParallelDetail::worker(count, chunkSize, function, &next);
+	for (size_t i = 0; i < threads.size(); ++i) {
+		threads[i].join();
+	}
+}
+
+#endif
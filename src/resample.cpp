@@ -0,0 +1,298 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <utility>
+#include <cmath>
+
+#include "resample.h"
+#include "buffergeometry.h"
+#include "skeleton.h"
+#include "parallel.h"
+#include "simd.h"
+#include "allocationcounter.h"
+
+// Frames per parallelFor chunk. Each chunk positions its cursors with one binary search.
+static const size_t framesPerChunk = 256;
+
+namespace {
+
+// A bone's channels in the clip. An empty channel holds the bone's node transform.
+struct BoneChannels {
+	const std::vector<aiVectorKey>* positionKeys;
+	const std::vector<aiQuatKey>* rotationKeys;
+	const std::vector<aiVectorKey>* scaleKeys;
+	glm::simdVec4 bindPosition;
+	glm::simdVec4 bindRotation;
+	glm::simdVec4 bindScale;
+};
+
+}
+
+static glm::simdVec4 toSimd(const aiVector3D& v) {
+	return glm::simdVec4(v.x, v.y, v.z, 0.0f);
+}
+
+static glm::simdVec4 toSimd(const aiQuaternion& q) {
+	return glm::simdVec4(q.x, q.y, q.z, q.w);
+}
+
+template <typename Key>
+static size_t firstKeyAfter(const std::vector<Key>& keys, double time) {
+	return std::upper_bound(keys.begin(), keys.end(), time, KeyTimeLess()) - keys.begin();
+}
+
+// Moves cursor forward to the first key after time. Returns false when time is outside the
+// keys, with key set to the clamped key; otherwise key and t bracket time.
+template <typename Key>
+static bool seek(const std::vector<Key>& keys, size_t& cursor, double time, size_t& key, float& t) {
+	size_t count = keys.size();
+	while (cursor < count && keys[cursor].mTime <= time) {
+		++cursor;
+	}
+	if (cursor == 0 || cursor == count) {
+		key = cursor ? count - 1 : 0;
+		return false;
+	}
+	key = cursor - 1;
+	t = float((time - keys[key].mTime) / (keys[cursor].mTime - keys[key].mTime));
+	return true;
+}
+
+static glm::simdVec4 sampleLinear(const std::vector<aiVectorKey>& keys, size_t& cursor, double time, const glm::simdVec4& fallback) {
+	if (keys.empty()) {
+		return fallback;
+	}
+	size_t key;
+	float t;
+	if (!seek(keys, cursor, time, key, t)) {
+		return toSimd(keys[key].mValue);
+	}
+	glm::simdVec4 a = toSimd(keys[key].mValue);
+	return a + (toSimd(keys[key + 1].mValue) - a) * t;
+}
+
+// The keys around time, with a == b and t == 0 outside the keys.
+static void bracketRotation(const std::vector<aiQuatKey>& keys, size_t& cursor, double time, const glm::simdVec4& fallback,
+	glm::simdVec4& a, glm::simdVec4& b, float& t) {
+
+	size_t key;
+	t = 0.0f;
+	if (keys.empty()) {
+		a = b = fallback;
+	} else if (!seek(keys, cursor, time, key, t)) {
+		a = b = toSimd(keys[key].mValue);
+	} else {
+		a = toSimd(keys[key].mValue);
+		b = toSimd(keys[key + 1].mValue);
+	}
+}
+
+/*
+
+Slerp weights sin((1 - t) angle) / sin(angle) and sin(t angle) / sin(angle) without acos or
+sin, from Eberly, "A Fast and Accurate Algorithm for Computing SLERP": an 8-term series in
+cos(angle) - 1, with the last term scaled to absorb the truncation. For cos(angle) >= 0 the
+weights are within 2e-5 of exact.
+
+*/
+
+static const float slerpCorrection = 1.85298109240830f;
+static const float slerpU[8] = {
+	1.0f / (1 * 3), 1.0f / (2 * 5), 1.0f / (3 * 7), 1.0f / (4 * 9),
+	1.0f / (5 * 11), 1.0f / (6 * 13), 1.0f / (7 * 15), slerpCorrection / (8 * 17)
+};
+static const float slerpV[8] = {
+	1.0f / 3, 2.0f / 5, 3.0f / 7, 4.0f / 9,
+	5.0f / 11, 6.0f / 13, 7.0f / 15, slerpCorrection * 8 / 17
+};
+
+static glm::simdVec4 slerpWeight(const glm::simdVec4& t, const glm::simdVec4& cosineMinusOne) {
+	glm::simdVec4 t2 = t * t;
+	glm::simdVec4 weight(1.0f);
+	for (int i = 7; i >= 0; --i) {
+		weight = glm::simdVec4(1.0f) + (t2 * slerpU[i] - slerpV[i]) * cosineMinusOne * weight;
+	}
+	return t * weight;
+}
+
+// Shortest-path slerp of four bones at once, one bone per SIMD lane. a, b and t hold the
+// four bones; out receives their normalized xyzw.
+static void slerp4(const glm::simdVec4* a, const glm::simdVec4* b, const float* t, float* out) {
+	__m128 ax = a[0].Data, ay = a[1].Data, az = a[2].Data, aw = a[3].Data;
+	__m128 bx = b[0].Data, by = b[1].Data, bz = b[2].Data, bw = b[3].Data;
+	_MM_TRANSPOSE4_PS(ax, ay, az, aw);
+	_MM_TRANSPOSE4_PS(bx, by, bz, bw);
+
+	// Negating b where the cosine is negative takes the short way around. The sign bit is
+	// cleared by hand: glm 0.9.4's abs() for simdVec4 returns zero.
+	glm::simdVec4 cosine = glm::simdVec4(ax) * bx + glm::simdVec4(ay) * by + glm::simdVec4(az) * bz + glm::simdVec4(aw) * bw;
+	__m128 flip = _mm_and_ps(cosine.Data, _mm_set1_ps(-0.0f));
+	glm::simdVec4 cosineMinusOne = glm::simdVec4(_mm_xor_ps(cosine.Data, flip)) - 1.0f;
+
+	glm::simdVec4 tb(_mm_loadu_ps(t));
+	glm::simdVec4 wa = slerpWeight(1.0f - tb, cosineMinusOne);
+	glm::simdVec4 wb = glm::simdVec4(_mm_xor_ps(slerpWeight(tb, cosineMinusOne).Data, flip));
+
+	glm::simdVec4 x = glm::simdVec4(ax) * wa + glm::simdVec4(bx) * wb;
+	glm::simdVec4 y = glm::simdVec4(ay) * wa + glm::simdVec4(by) * wb;
+	glm::simdVec4 z = glm::simdVec4(az) * wa + glm::simdVec4(bz) * wb;
+	glm::simdVec4 w = glm::simdVec4(aw) * wa + glm::simdVec4(bw) * wb;
+	glm::simdVec4 inverseLength = glm::inversesqrt(x * x + y * y + z * z + w * w);
+
+	__m128 rx = (x * inverseLength).Data, ry = (y * inverseLength).Data, rz = (z * inverseLength).Data, rw = (w * inverseLength).Data;
+	_MM_TRANSPOSE4_PS(rx, ry, rz, rw);
+	_mm_storeu_ps(out + 0, rx);
+	_mm_storeu_ps(out + 4, ry);
+	_mm_storeu_ps(out + 8, rz);
+	_mm_storeu_ps(out + 12, rw);
+}
+
+namespace {
+
+// Samples every bone for a range of frames; ranges write to disjoint slices of the clip.
+struct ResampleJob {
+	const std::vector<BoneChannels>* channels;
+	double ticksPerFrame;
+	double lengthTicks;
+	ResampledClip* clip;
+
+	void operator()(size_t first, size_t last) const {
+		const std::vector<BoneChannels>& bones = *channels;
+		size_t boneCount = bones.size();
+
+		// Rotations are gathered per frame and slerped four bones at a time; the padding
+		// lanes hold identity.
+		size_t paddedCount = (boneCount + 3) & ~size_t(3);
+		std::vector<glm::simdVec4> rotationA(paddedCount, glm::simdVec4(0.0f, 0.0f, 0.0f, 1.0f));
+		std::vector<glm::simdVec4> rotationB(paddedCount, glm::simdVec4(0.0f, 0.0f, 0.0f, 1.0f));
+		std::vector<float> rotationT(paddedCount, 0.0f);
+
+		double firstTime = std::min(first * ticksPerFrame, lengthTicks);
+		std::vector<size_t> cursors(boneCount * 3);
+		for (size_t b = 0; b < boneCount; ++b) {
+			cursors[b * 3 + 0] = firstKeyAfter(*bones[b].positionKeys, firstTime);
+			cursors[b * 3 + 1] = firstKeyAfter(*bones[b].rotationKeys, firstTime);
+			cursors[b * 3 + 2] = firstKeyAfter(*bones[b].scaleKeys, firstTime);
+		}
+
+		for (size_t frame = first; frame < last; ++frame) {
+			double time = std::min(frame * ticksPerFrame, lengthTicks);
+			float* positions = &clip->positions[frame * boneCount * 3];
+			float* rotations = &clip->rotations[frame * boneCount * 4];
+			float* scales = &clip->scales[frame * boneCount * 3];
+			for (size_t b = 0; b < boneCount; ++b) {
+				const BoneChannels& bone = bones[b];
+				glm::vec4 p = glm::vec4_cast(sampleLinear(*bone.positionKeys, cursors[b * 3 + 0], time, bone.bindPosition));
+				glm::vec4 s = glm::vec4_cast(sampleLinear(*bone.scaleKeys, cursors[b * 3 + 2], time, bone.bindScale));
+				positions[b * 3 + 0] = p.x; positions[b * 3 + 1] = p.y; positions[b * 3 + 2] = p.z;
+				scales[b * 3 + 0] = s.x; scales[b * 3 + 1] = s.y; scales[b * 3 + 2] = s.z;
+				bracketRotation(*bone.rotationKeys, cursors[b * 3 + 1], time, bone.bindRotation, rotationA[b], rotationB[b], rotationT[b]);
+			}
+
+			size_t b = 0;
+			for (; b + 4 <= boneCount; b += 4) {
+				slerp4(&rotationA[b], &rotationB[b], &rotationT[b], &rotations[b * 4]);
+			}
+			if (b < boneCount) {
+				float tail[16];
+				slerp4(&rotationA[b], &rotationB[b], &rotationT[b], tail);
+				std::copy(tail, tail + (boneCount - b) * 4, &rotations[b * 4]);
+			}
+		}
+	}
+};
+
+}
+
+// Flips each rotation to the hemisphere of the bone's previous frame, so a runtime can nlerp
+// between neighbouring frames without checking the sign.
+static void makeRotationsContinuous(ResampledClip& clip) {
+	size_t stride = size_t(clip.boneCount) * 4;
+	for (size_t frame = 1; frame < clip.frameCount; ++frame) {
+		const float* previous = &clip.rotations[(frame - 1) * stride];
+		float* current = &clip.rotations[frame * stride];
+		for (size_t i = 0; i < stride; i += 4) {
+			float dot = previous[i] * current[i] + previous[i + 1] * current[i + 1] + previous[i + 2] * current[i + 2] + previous[i + 3] * current[i + 3];
+			if (dot < 0.0f) {
+				current[i] = -current[i]; current[i + 1] = -current[i + 1]; current[i + 2] = -current[i + 2]; current[i + 3] = -current[i + 3];
+			}
+		}
+	}
+}
+
+std::vector<ResampledClip> resampleAnimations(const Mesh& mesh, const ResampleOptions& options) {
+	StageAllocations stageAllocations("resampleAnimations");
+	std::cout << "\n\nResampling animations at " << options.sampleRate << " fps.";
+
+	std::vector<ResampledClip> clips;
+	if (mesh.bones.empty() || options.sampleRate <= 0.0f) {
+		return clips;
+	}
+
+	std::vector<const MeshBone*> bones;
+	std::string error;
+	if (!bonesByIndex(mesh, bones, error)) {
+		std::cout << "\nSkipped: " << error << ".";
+		return clips;
+	}
+	size_t boneCount = bones.size();
+
+	for (AnimationInfoConstIterator it = mesh.animations.begin(); it != mesh.animations.end(); ++it) {
+		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		const AnimationInfo& info = it->second;
+		double ticksPerSecond = info.fps > 0.0f ? info.fps : defaultTicksPerSecond;
+		double seconds = info.length / ticksPerSecond;
+
+		static const AnimationKeys noKeys;
+		std::vector<BoneChannels> channels(boneCount);
+		for (size_t b = 0; b < boneCount; ++b) {
+			aiVector3D bindScale; aiQuaternion bindRotation; aiVector3D bindPosition;
+			bones[b]->nodeTransform.Decompose(bindScale, bindRotation, bindPosition);
+
+			AnimationKeysConstIterator keys = bones[b]->animations.find(it->first);
+			const AnimationKeys& channel = keys != bones[b]->animations.end() ? keys->second : noKeys;
+			channels[b].positionKeys = &channel.positionKeys;
+			channels[b].rotationKeys = &channel.rotationKeys;
+			channels[b].scaleKeys = &channel.scaleKeys;
+			channels[b].bindPosition = toSimd(bindPosition);
+			channels[b].bindRotation = toSimd(bindRotation);
+			channels[b].bindScale = toSimd(bindScale);
+		}
+
+		ResampledClip clip;
+		clip.name = it->first;
+		clip.sampleRate = options.sampleRate;
+		clip.frameCount = (unsigned int)std::floor(seconds * options.sampleRate + 1e-6) + 1;
+		clip.boneCount = boneCount;
+		clip.positions.resize(size_t(clip.frameCount) * boneCount * 3);
+		clip.rotations.resize(size_t(clip.frameCount) * boneCount * 4);
+		clip.scales.resize(size_t(clip.frameCount) * boneCount * 3);
+
+		ResampleJob job = { &channels, ticksPerSecond / options.sampleRate, info.length, &clip };
+		parallelFor(clip.frameCount, framesPerChunk, options.threadCount, job);
+		makeRotationsContinuous(clip);
+
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+		std::cout << "\n    " << clip.name << ": " << clip.frameCount << " frames, " << boneCount << " bones in " << milliseconds << " ms";
+		clips.push_back(std::move(clip));
+	}
+
+	return clips;
+}
+
+Json::Value resampledAnimationsToJson(const std::vector<ResampledClip>& clips, bool base64) {
+	Json::Value root = Json::Value(Json::arrayValue);
+	for (size_t i = 0; i < clips.size(); ++i) {
+		const ResampledClip& clip = clips[i];
+		Json::Value json;
+		json["name"] = clip.name;
+		json["fps"] = clip.sampleRate;
+		json["frames"] = clip.frameCount;
+		json["bones"] = clip.boneCount;
+		json.emplace("positions", typedArrayToJson("Float32Array", 3, clip.positions, base64));
+		json.emplace("rotations", typedArrayToJson("Float32Array", 4, clip.rotations, base64));
+		json.emplace("scales", typedArrayToJson("Float32Array", 3, clip.scales, base64));
+		root.append(std::move(json));
+	}
+	return root;
+}
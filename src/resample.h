@@ -0,0 +1,54 @@
+#ifndef ASSIMP_TO_JSON_RESAMPLE_H
+#define ASSIMP_TO_JSON_RESAMPLE_H
+
+#include <string>
+#include <vector>
+
+#include <json\json.h>
+
+#include "mesh.h"
+
+/*
+
+Resamples every animation clip at a fixed frame rate. Source clips have irregular key times
+per channel. After resampling, every bone has one position, rotation and scale per frame,
+so a runtime finds the frame with a single multiply (frame = seconds * fps) instead of
+searching the key times.
+
+Each clip is sampled at sampleRate frames per second over its length. Bones are in bone
+index order. A channel without keys keeps the bone's node transform. Position and scale are
+interpolated linearly. Rotation uses shortest-path slerp with polynomial weights (no acos
+or sin), within 0.001 degrees of glm::slerp. Each channel walks its keys with a cursor that
+only moves forward. Rotations are slerped four bones at a time, one per lane of glm's SIMD
+vectors. Frame ranges are spread over threadCount worker threads.
+
+The arrays are frame-major:
+	positions[(frame * bones + bone) * 3]   xyz
+	rotations[(frame * bones + bone) * 4]   xyzw, sign-continuous along each bone
+	scales[(frame * bones + bone) * 3]      xyz
+
+*/
+
+struct ResampleOptions {
+	ResampleOptions() : sampleRate(30.0f), threadCount(0) {}
+
+	float sampleRate;
+	// 0 uses std::thread::hardware_concurrency().
+	unsigned int threadCount;
+};
+
+struct ResampledClip {
+	std::string name;
+	float sampleRate;
+	unsigned int frameCount;
+	unsigned int boneCount;
+	std::vector<float> positions;
+	std::vector<float> rotations;
+	std::vector<float> scales;
+};
+
+std::vector<ResampledClip> resampleAnimations(const Mesh& mesh, const ResampleOptions& options);
+
+Json::Value resampledAnimationsToJson(const std::vector<ResampledClip>& clips, bool base64);
+
+#endif
@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <cmath>
+
+#include "rotationpacking.h"
+#include "buffergeometry.h"
+
+static const float inverseSqrt2 = 0.70710678118f;
+
+static unsigned int quantize(float value, unsigned int maxValue) {
+	float q = (value + inverseSqrt2) * (maxValue / (2.0f * inverseSqrt2));
+	return (unsigned int)std::min(std::max(std::floor(q + 0.5f), 0.0f), float(maxValue));
+}
+
+static float dequantize(unsigned int value, unsigned int maxValue) {
+	return value * (2.0f * inverseSqrt2 / maxValue) - inverseSqrt2;
+}
+
+PackedRotations packRotations(const std::vector<aiQuatKey>& keys, unsigned int bits) {
+	PackedRotations packed;
+	packed.bits = std::min(std::max(bits, 2u), 15u);
+	packed.maxErrorDegrees = 0.0;
+	packed.sumErrorDegrees = 0.0;
+	packed.count = keys.size();
+	unsigned int maxValue = (1u << packed.bits) - 1;
+
+	for (size_t k = 0; k < keys.size(); ++k) {
+		const aiQuaternion& r = keys[k].mValue;
+		float q[4] = { r.x, r.y, r.z, r.w };
+		float length = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+		if (length <= 0.0f) {
+			q[0] = q[1] = q[2] = 0.0f;
+			q[3] = length = 1.0f;
+		}
+
+		unsigned int largest = 0;
+		for (unsigned int c = 1; c < 4; ++c) {
+			if (std::fabs(q[c]) > std::fabs(q[largest])) {
+				largest = c;
+			}
+		}
+		float sign = q[largest] < 0.0f ? -1.0f : 1.0f;
+
+		unsigned int components[3];
+		for (unsigned int c = 0, i = 0; c < 4; ++c) {
+			if (c != largest) {
+				components[i++] = quantize(q[c] * sign / length, maxValue);
+			}
+		}
+
+		if (packed.bits <= 10) {
+			packed.words32.push_back((largest << 30) | (components[0] << (2 * packed.bits)) | (components[1] << packed.bits) | components[2]);
+		} else {
+			packed.words16.push_back((unsigned short)(components[0] | ((largest & 1) << 15)));
+			packed.words16.push_back((unsigned short)(components[1] | ((largest >> 1) << 15)));
+			packed.words16.push_back((unsigned short)components[2]);
+		}
+
+		// Rotation angle between the two, from the chord length; acos loses precision near 1.
+		aiQuaternion decoded = unpackRotation(packed, k);
+		double d[4] = { decoded.x, decoded.y, decoded.z, decoded.w };
+		double chord = 0.0;
+		for (unsigned int c = 0; c < 4; ++c) {
+			double difference = q[c] * sign / length - d[c];
+			chord += difference * difference;
+		}
+		double error = 4.0 * std::asin(std::min(std::sqrt(chord) * 0.5, 1.0)) * 180.0 / 3.14159265358979;
+		packed.maxErrorDegrees = std::max(packed.maxErrorDegrees, error);
+		packed.sumErrorDegrees += error;
+	}
+
+	return packed;
+}
+
+aiQuaternion unpackRotation(const PackedRotations& packed, size_t key) {
+	unsigned int maxValue = (1u << packed.bits) - 1;
+	unsigned int largest;
+	unsigned int components[3];
+	if (packed.bits <= 10) {
+		unsigned int word = packed.words32[key];
+		largest = word >> 30;
+		components[0] = (word >> (2 * packed.bits)) & maxValue;
+		components[1] = (word >> packed.bits) & maxValue;
+		components[2] = word & maxValue;
+	} else {
+		const unsigned short* words = &packed.words16[key * 3];
+		largest = (words[0] >> 15) | ((words[1] >> 15) << 1);
+		components[0] = words[0] & maxValue;
+		components[1] = words[1] & maxValue;
+		components[2] = words[2] & maxValue;
+	}
+
+	float q[4];
+	float sum = 0.0f;
+	for (unsigned int c = 0, i = 0; c < 4; ++c) {
+		if (c != largest) {
+			q[c] = dequantize(components[i++], maxValue);
+			sum += q[c] * q[c];
+		}
+	}
+	q[largest] = std::sqrt(std::max(0.0f, 1.0f - sum));
+
+	aiQuaternion result;
+	result.x = q[0];
+	result.y = q[1];
+	result.z = q[2];
+	result.w = q[3];
+	return result;
+}
+
+Json::Value packedRotationsToJson(const PackedRotations& packed, bool base64) {
+	Json::Value json;
+	json["encoding"] = "smallest-three";
+	json["bits"] = packed.bits;
+	if (packed.bits <= 10) {
+		json.emplace("values", typedArrayToJson("Uint32Array", 1, packed.words32, base64));
+	} else {
+		json.emplace("values", typedArrayToJson("Uint16Array", 3, packed.words16, base64));
+	}
+	return json;
+}
@@ -0,0 +1,48 @@
+#ifndef ASSIMP_TO_JSON_ROTATION_PACKING_H
+#define ASSIMP_TO_JSON_ROTATION_PACKING_H
+
+#include <vector>
+
+#include <json\json.h>
+
+#include <assimp\scene.h>
+
+/*
+
+Smallest-three quaternion packing for rotation tracks.
+
+The largest component of a unit quaternion is dropped. It is recovered as
+sqrt(1 - a*a - b*b - c*c). Its sign is made positive, since q and -q are the same rotation.
+The other three lie in [-1/sqrt(2), 1/sqrt(2)] and are quantized to bits each:
+	v = q * (sqrt(2) / (2^bits - 1)) - 1/sqrt(2)
+The 2-bit index names the dropped component (0 x, 1 y, 2 z, 3 w); the other three follow
+in x, y, z, w order.
+
+	bits <= 10   One Uint32 per key. The index is in bits 30-31 and the components in
+	             bits [2*bits, 3*bits), [bits, 2*bits) and [0, bits).
+	bits > 10    Three Uint16 per key, one component in the low bits of each. The index
+	             is bit 15 of the first word plus bit 15 of the second (high bit).
+
+Each pack reports the largest and mean angle between the source and decoded rotations.
+
+*/
+
+struct PackedRotations {
+	unsigned int bits;
+	std::vector<unsigned int> words32;
+	std::vector<unsigned short> words16;
+	double maxErrorDegrees;
+	double sumErrorDegrees;
+	size_t count;
+};
+
+// bits is clamped to [2, 15].
+PackedRotations packRotations(const std::vector<aiQuatKey>& keys, unsigned int bits);
+
+aiQuaternion unpackRotation(const PackedRotations& packed, size_t key);
+
+// {"encoding": "smallest-three", "bits", "values"}, values in the typed array form of
+// typedArrayToJson().
+Json::Value packedRotationsToJson(const PackedRotations& packed, bool base64);
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef ASSIMP_TO_JSON_SIMD_H
+#define ASSIMP_TO_JSON_SIMD_H
+
+/*
+
+Includes glm's SSE2 types (simdVec4, simdMat4) for the geometry stages.
+
+glm 0.9.4 only recognizes GCC releases up to 5.0. Newer releases fall through to
+GLM_COMPILER_GCC, where GLM_ALIGN and GLM_ALIGNED_STRUCT expand to nothing and the SIMD
+headers stop compiling. This header restores the GCC definitions before including them.
+
+*/
+
+#include <glm\glm.hpp>
+
+#if (GLM_COMPILER == GLM_COMPILER_GCC)
+#	undef GLM_ALIGN
+#	define GLM_ALIGN(x) __attribute__((aligned(x)))
+#	undef GLM_ALIGNED_STRUCT
+#	define GLM_ALIGNED_STRUCT(x) struct __attribute__((aligned(x)))
+#endif
+
+#include <glm\gtx\simd_vec4.hpp>
+#include <glm\gtx\simd_mat4.hpp>
+
+#endif
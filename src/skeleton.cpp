@@ -0,0 +1,174 @@
+#include <algorithm>
+
+#include <glm\gtc\matrix_transform.hpp>
+#include <glm\gtc\quaternion.hpp>
+
+#include "skeleton.h"
+
+static glm::mat4 toGlm(const aiMatrix4x4& m) {
+	glm::mat4 result;
+	for (unsigned int row = 0; row < 4; ++row) {
+		for (unsigned int column = 0; column < 4; ++column) {
+			result[column][row] = m[row][column];
+		}
+	}
+	return result;
+}
+
+static glm::vec3 toGlm(const aiVector3D& v) {
+	return glm::vec3(v.x, v.y, v.z);
+}
+
+static glm::quat toGlm(const aiQuaternion& q) {
+	return glm::quat(q.w, q.x, q.y, q.z);
+}
+
+aiVector3D sampleVectorKeys(const std::vector<aiVectorKey>& keys, double time, const aiVector3D& fallback) {
+	if (keys.empty()) {
+		return fallback;
+	}
+	std::vector<aiVectorKey>::const_iterator next = std::upper_bound(keys.begin(), keys.end(), time, KeyTimeLess());
+	if (next == keys.begin()) {
+		return keys.front().mValue;
+	}
+	if (next == keys.end()) {
+		return keys.back().mValue;
+	}
+	const aiVectorKey& previous = *(next - 1);
+	float t = float((time - previous.mTime) / (next->mTime - previous.mTime));
+	return previous.mValue + (next->mValue - previous.mValue) * t;
+}
+
+aiQuaternion sampleRotationKeys(const std::vector<aiQuatKey>& keys, double time, const aiQuaternion& fallback) {
+	if (keys.empty()) {
+		return fallback;
+	}
+	std::vector<aiQuatKey>::const_iterator next = std::upper_bound(keys.begin(), keys.end(), time, KeyTimeLess());
+	if (next == keys.begin()) {
+		return keys.front().mValue;
+	}
+	if (next == keys.end()) {
+		return keys.back().mValue;
+	}
+	const aiQuatKey& previous = *(next - 1);
+	aiQuaternion rotation;
+	aiQuaternion::Interpolate(rotation, previous.mValue, next->mValue, float((time - previous.mTime) / (next->mTime - previous.mTime)));
+	return rotation.Normalize();
+}
+
+std::vector<double> animationKeyTimes(const Mesh& mesh, const std::string& animationName) {
+	std::vector<double> times;
+	for (MeshBonesConstIterator i = mesh.bones.begin(); i != mesh.bones.end(); ++i) {
+		AnimationKeysConstIterator keys = i->second.animations.find(animationName);
+		if (keys == i->second.animations.end()) {
+			continue;
+		}
+		for (size_t k = 0; k < keys->second.positionKeys.size(); ++k) times.push_back(keys->second.positionKeys[k].mTime);
+		for (size_t k = 0; k < keys->second.rotationKeys.size(); ++k) times.push_back(keys->second.rotationKeys[k].mTime);
+		for (size_t k = 0; k < keys->second.scaleKeys.size(); ++k) times.push_back(keys->second.scaleKeys[k].mTime);
+	}
+	std::sort(times.begin(), times.end());
+	times.erase(std::unique(times.begin(), times.end()), times.end());
+	return times;
+}
+
+static const glm::simdMat4& worldTransform(int index, const std::vector<const MeshBone*>& bones,
+	const std::vector<glm::simdMat4>& local, std::vector<glm::simdMat4>& world, std::vector<bool>& done) {
+
+	if (!done[index]) {
+		int parent = bones[index]->pindex;
+		world[index] = parent >= 0 && parent != index
+			? worldTransform(parent, bones, local, world, done) * local[index]
+			: local[index];
+		done[index] = true;
+	}
+	return world[index];
+}
+
+void evaluateSkinMatrices(const std::vector<const MeshBone*>& bones, const std::string& animationName, double time,
+	std::vector<glm::simdMat4>& skinMatrices) {
+
+	size_t numBones = bones.size();
+
+	// Each local transform is built in glm::mat4 once; composing the hierarchy is all SIMD.
+	std::vector<glm::simdMat4> local(numBones);
+	for (size_t b = 0; b < numBones; ++b) {
+		const MeshBone& bone = *bones[b];
+		AnimationKeysConstIterator keys = bone.animations.find(animationName);
+		if (keys == bone.animations.end()) {
+			local[b] = glm::simdMat4(toGlm(bone.nodeTransform));
+			continue;
+		}
+
+		aiVector3D bindScale; aiQuaternion bindRotation; aiVector3D bindPosition;
+		bone.nodeTransform.Decompose(bindScale, bindRotation, bindPosition);
+
+		glm::vec3 position = toGlm(sampleVectorKeys(keys->second.positionKeys, time, bindPosition));
+		glm::quat rotation = toGlm(sampleRotationKeys(keys->second.rotationKeys, time, bindRotation));
+		glm::vec3 scale = toGlm(sampleVectorKeys(keys->second.scaleKeys, time, bindScale));
+		local[b] = glm::simdMat4(glm::scale(glm::translate(glm::mat4(1.0f), position) * glm::mat4_cast(rotation), scale));
+	}
+
+	std::vector<glm::simdMat4> world(numBones);
+	std::vector<bool> done(numBones, false);
+	skinMatrices.resize(numBones);
+	for (size_t b = 0; b < numBones; ++b) {
+		skinMatrices[b] = worldTransform(b, bones, local, world, done) * glm::simdMat4(toGlm(bones[b]->offsetMatrix));
+	}
+}
+
+void skinVertices(const Mesh& mesh, const std::vector<glm::simdMat4>& skinMatrices,
+	const std::vector<unsigned short>& boneIndices, const std::vector<float>& boneWeights,
+	unsigned int influencesPerVertex, size_t first, size_t last, glm::simdVec4* out) {
+
+	for (size_t v = first; v < last; ++v) {
+		const aiVector3D& p = mesh.vertex[v];
+		glm::simdVec4 position(p.x, p.y, p.z, 1.0f);
+
+		const unsigned short* indices = &boneIndices[v * influencesPerVertex];
+		const float* weights = &boneWeights[v * influencesPerVertex];
+		if (weights[0] <= 0.0f) {
+			out[v - first] = position;
+			continue;
+		}
+
+		glm::simdVec4 skinned(0.0f);
+		for (unsigned int i = 0; i < influencesPerVertex && weights[i] > 0.0f; ++i) {
+			skinned = skinned + (skinMatrices[indices[i]] * position) * weights[i];
+		}
+		out[v - first] = skinned;
+	}
+}
+
+void skinNormals(const Mesh& mesh, const std::vector<glm::simdMat4>& skinMatrices,
+	const std::vector<unsigned short>& boneIndices, const std::vector<float>& boneWeights,
+	unsigned int influencesPerVertex, size_t first, size_t last, glm::simdVec4* out) {
+
+	for (size_t v = first; v < last; ++v) {
+		const aiVector3D& n = v < mesh.normal.size() ? mesh.normal[v] : aiVector3D(0.0f, 0.0f, 1.0f);
+		glm::simdVec4 normal(n.x, n.y, n.z, 0.0f);
+
+		const unsigned short* indices = &boneIndices[v * influencesPerVertex];
+		const float* weights = &boneWeights[v * influencesPerVertex];
+		if (weights[0] <= 0.0f) {
+			out[v - first] = normal;
+			continue;
+		}
+
+		// Normals take the inverse transpose of the blended matrix, which keeps them
+		// perpendicular under non-uniform scale. That is the cofactor matrix divided by the
+		// determinant; only the determinant's sign matters after renormalization.
+		// cofactor * n = n.x (c1 x c2) + n.y (c2 x c0) + n.z (c0 x c1).
+		glm::simdVec4 c0(0.0f), c1(0.0f), c2(0.0f);
+		for (unsigned int i = 0; i < influencesPerVertex && weights[i] > 0.0f; ++i) {
+			const glm::simdMat4& m = skinMatrices[indices[i]];
+			c0 = c0 + m[0] * weights[i];
+			c1 = c1 + m[1] * weights[i];
+			c2 = c2 + m[2] * weights[i];
+		}
+		glm::simdVec4 c12 = glm::cross(c1, c2);
+		glm::simdVec4 skinned = c12 * n.x + glm::cross(c2, c0) * n.y + glm::cross(c0, c1) * n.z;
+		float length = glm::dot(c0, c12) < 0.0f ? -glm::length(skinned) : glm::length(skinned);
+		out[v - first] = length != 0.0f ? skinned * (1.0f / length) : normal;
+	}
+}
@@ -0,0 +1,53 @@
+#ifndef ASSIMP_TO_JSON_SKELETON_H
+#define ASSIMP_TO_JSON_SKELETON_H
+
+#include <string>
+#include <vector>
+
+#include "mesh.h"
+#include "simd.h"
+
+/*
+
+Evaluates the skeleton of a Mesh at an arbitrary animation time, for stages that need
+the skinned geometry offline (animation bounds, baked vertex animation).
+
+Times are in animation ticks, as in AnimationKeys. Bones without keys in the clip keep
+their node transform. Position and scale are interpolated linearly, rotation with
+slerp. Root bones are relative to the armature, as in the legacy three.js output, so
+the armature's own transform is not applied.
+
+*/
+
+// Compares a time with a key's mTime, for std::upper_bound over a key track.
+struct KeyTimeLess {
+	template <typename Key>
+	bool operator()(double time, const Key& key) const { return time < key.mTime; }
+};
+
+// A channel's value at time: held outside its keys and interpolated between them (linearly,
+// or with shortest-path slerp for rotations). fallback is used when the channel has no keys.
+aiVector3D sampleVectorKeys(const std::vector<aiVectorKey>& keys, double time, const aiVector3D& fallback);
+aiQuaternion sampleRotationKeys(const std::vector<aiQuatKey>& keys, double time, const aiQuaternion& fallback);
+
+// Sorted, unique key times of every bone channel in the animation.
+std::vector<double> animationKeyTimes(const Mesh& mesh, const std::string& animationName);
+
+// Per bone index: world transform * offset matrix, which maps bind-pose vertices into
+// the animated pose. bones is the table from bonesByIndex().
+void evaluateSkinMatrices(const std::vector<const MeshBone*>& bones, const std::string& animationName, double time,
+	std::vector<glm::simdMat4>& skinMatrices);
+
+// Linear blend skins vertices [first, last) with the influences from collectSkinInfluences.
+// Unweighted vertices keep their bind-pose position. w of every output is 1.
+void skinVertices(const Mesh& mesh, const std::vector<glm::simdMat4>& skinMatrices,
+	const std::vector<unsigned short>& boneIndices, const std::vector<float>& boneWeights,
+	unsigned int influencesPerVertex, size_t first, size_t last, glm::simdVec4* out);
+
+// Same as skinVertices for normals (w = 0): transformed by the inverse transpose of the
+// blended skin matrix, so non-uniform bone scale keeps them perpendicular, then renormalized.
+void skinNormals(const Mesh& mesh, const std::vector<glm::simdMat4>& skinMatrices,
+	const std::vector<unsigned short>& boneIndices, const std::vector<float>& boneWeights,
+	unsigned int influencesPerVertex, size_t first, size_t last, glm::simdVec4* out);
+
+#endif
@@ -0,0 +1,284 @@
+#include <iostream>
+#include <algorithm>
+#include <utility>
+#include <cmath>
+#include <cstring>
+
+#include "vertexlayout.h"
+#include "base64.h"
+#include "allocationcounter.h"
+
+struct ComponentFormatInfo {
+	const char* name;
+	unsigned int size;
+	// WebGL component type enum.
+	int type;
+	bool normalized;
+};
+
+// Indexed by ComponentFormat.
+static const ComponentFormatInfo componentFormats[] = {
+	{ "float32", 4, 5126, false },
+	{ "float16", 2, 5131, false },
+	{ "snorm16", 2, 5122, true },
+	{ "unorm16", 2, 5123, true },
+	{ "uint16",  2, 5123, false },
+	{ "snorm8",  1, 5120, true },
+	{ "unorm8",  1, 5121, true },
+	{ "uint8",   1, 5121, false }
+};
+static const unsigned int componentFormatCount = sizeof(componentFormats) / sizeof(componentFormats[0]);
+
+static const char* const attributeNames[] = { "position", "normal", "tangent", "uv", "skinIndex", "skinWeight" };
+static const unsigned int attributeNameCount = sizeof(attributeNames) / sizeof(attributeNames[0]);
+
+unsigned int componentSize(ComponentFormat format) {
+	return componentFormats[format].size;
+}
+
+bool parseVertexFormats(const std::string& list, std::vector<VertexAttributeFormat>& formats, std::string& error) {
+	std::string::size_type start = 0;
+	while (start < list.length()) {
+		std::string::size_type end = list.find(',', start);
+		if (end == std::string::npos) {
+			end = list.length();
+		}
+		std::string entry = list.substr(start, end - start);
+		start = end + 1;
+
+		std::string::size_type colon = entry.find(':');
+		std::string name = entry.substr(0, colon);
+		std::string format = colon == std::string::npos ? "float32" : entry.substr(colon + 1);
+
+		bool knownName = false;
+		for (unsigned int i = 0; i < attributeNameCount; ++i) {
+			knownName = knownName || name == attributeNames[i];
+		}
+		unsigned int f = 0;
+		while (f < componentFormatCount && format != componentFormats[f].name) {
+			++f;
+		}
+		if (!knownName || f == componentFormatCount) {
+			error = entry;
+			return false;
+		}
+		formats.push_back(VertexAttributeFormat(name, ComponentFormat(f)));
+	}
+	return true;
+}
+
+// The attribute's values as floats, or false when the mesh does not have it.
+static bool attributeValues(const Mesh& mesh, const std::string& name, std::vector<float>& values, unsigned int& components) {
+	if (name == "position") {
+		values = flatten(mesh.vertex, mesh.vertex.size(), components = 3);
+	} else if (name == "normal" && !mesh.normal.empty()) {
+		values = flatten(mesh.normal, mesh.vertex.size(), components = 3);
+	} else if (name == "tangent" && !mesh.tangent.empty()) {
+		values = tangentsWithSign(mesh);
+		components = 4;
+	} else if (name == "uv" && !mesh.uv.empty()) {
+		values = flatten(mesh.uv, mesh.vertex.size(), components = 2);
+	} else if ((name == "skinIndex" || name == "skinWeight") && !mesh.bones.empty()) {
+		std::vector<unsigned short> skinIndex;
+		std::vector<float> skinWeight;
+		collectSkinInfluences(mesh, influencesPerVertex, skinIndex, skinWeight);
+		if (name == "skinIndex") {
+			values.assign(skinIndex.begin(), skinIndex.end());
+		} else {
+			values.swap(skinWeight);
+		}
+		components = influencesPerVertex;
+	} else {
+		return false;
+	}
+	return values.size() >= mesh.vertex.size() * components;
+}
+
+// IEEE half with round to nearest even; overflow becomes infinity.
+static unsigned short floatToHalf(float value) {
+	unsigned int bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	unsigned int sign = (bits >> 16) & 0x8000;
+	unsigned int mantissa = bits & 0x7fffff;
+	int exponent = int((bits >> 23) & 0xff) - 127 + 15;
+
+	if (((bits >> 23) & 0xff) == 0xff) {
+		return (unsigned short)(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+	}
+	if (exponent >= 31) {
+		return (unsigned short)(sign | 0x7c00);
+	}
+	if (exponent <= 0) {
+		if (exponent < -10) {
+			return (unsigned short)sign;
+		}
+		mantissa |= 0x800000;
+		unsigned int shift = 14 - exponent;
+		unsigned int half = mantissa >> shift;
+		unsigned int rest = mantissa & ((1u << shift) - 1);
+		unsigned int halfway = 1u << (shift - 1);
+		if (rest > halfway || (rest == halfway && (half & 1))) {
+			++half;
+		}
+		return (unsigned short)(sign | half);
+	}
+
+	unsigned int half = sign | ((unsigned int)exponent << 10) | (mantissa >> 13);
+	unsigned int rest = mantissa & 0x1fff;
+	if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) {
+		++half;
+	}
+	return (unsigned short)half;
+}
+
+static float clampf(float value, float lo, float hi) {
+	return std::min(std::max(value, lo), hi);
+}
+
+static void writeComponent(unsigned char* out, ComponentFormat format, float value) {
+	switch (format) {
+	case ComponentFloat32: {
+		std::memcpy(out, &value, 4);
+		break;
+	}
+	case ComponentFloat16: {
+		unsigned short half = floatToHalf(value);
+		std::memcpy(out, &half, 2);
+		break;
+	}
+	case ComponentSnorm16: {
+		short v = (short)std::floor(clampf(value, -1.0f, 1.0f) * 32767.0f + 0.5f);
+		std::memcpy(out, &v, 2);
+		break;
+	}
+	case ComponentUnorm16: {
+		unsigned short v = (unsigned short)std::floor(clampf(value, 0.0f, 1.0f) * 65535.0f + 0.5f);
+		std::memcpy(out, &v, 2);
+		break;
+	}
+	case ComponentUint16: {
+		unsigned short v = (unsigned short)clampf(std::floor(value + 0.5f), 0.0f, 65535.0f);
+		std::memcpy(out, &v, 2);
+		break;
+	}
+	case ComponentSnorm8:
+		*out = (unsigned char)(signed char)std::floor(clampf(value, -1.0f, 1.0f) * 127.0f + 0.5f);
+		break;
+	case ComponentUnorm8:
+		*out = (unsigned char)std::floor(clampf(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+		break;
+	case ComponentUint8:
+		*out = (unsigned char)clampf(std::floor(value + 0.5f), 0.0f, 255.0f);
+		break;
+	}
+}
+
+static unsigned int alignUp(unsigned int value, unsigned int alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+VertexLayout buildVertexLayout(const Mesh& mesh, const VertexLayoutOptions& options) {
+	StageAllocations stageAllocations("buildVertexLayout");
+	std::cout << "\n\nBuilding " << (options.interleaved ? "interleaved" : "separate") << " vertex layout.";
+
+	std::vector<VertexAttributeFormat> formats = options.attributes;
+	if (formats.empty()) {
+		for (unsigned int i = 0; i < attributeNameCount; ++i) {
+			formats.push_back(VertexAttributeFormat(attributeNames[i], std::string(attributeNames[i]) == "skinIndex" ? ComponentUint16 : ComponentFloat32));
+		}
+	}
+	unsigned int alignment = std::max(options.alignment, 1u);
+
+	VertexLayout layout;
+	layout.count = mesh.vertex.size();
+	std::vector< std::vector<float> > values;
+	unsigned int interleavedStride = 0;
+	unsigned int floatBytes = 0;
+
+	for (size_t i = 0; i < formats.size(); ++i) {
+		VertexLayoutAttribute attribute;
+		attribute.name = formats[i].name;
+		attribute.format = formats[i].format;
+
+		std::vector<float> attributeData;
+		if (!attributeValues(mesh, attribute.name, attributeData, attribute.components)) {
+			if (!options.attributes.empty()) {
+				std::cout << "\nSkipping " << attribute.name << ", the mesh does not have it.";
+			}
+			continue;
+		}
+		unsigned int size = attribute.components * componentSize(attribute.format);
+		floatBytes += attribute.components * 4;
+
+		if (options.interleaved) {
+			attribute.buffer = 0;
+			attribute.offset = alignUp(interleavedStride, alignment);
+			interleavedStride = attribute.offset + size;
+		} else {
+			attribute.buffer = layout.strides.size();
+			attribute.offset = 0;
+			layout.strides.push_back(alignUp(size, alignment));
+		}
+		layout.attributes.push_back(attribute);
+		values.push_back(std::move(attributeData));
+	}
+	if (options.interleaved && !layout.attributes.empty()) {
+		layout.strides.push_back(alignUp(interleavedStride, alignment));
+	}
+
+	layout.buffers.resize(layout.strides.size());
+	size_t totalBytes = 0;
+	for (size_t b = 0; b < layout.buffers.size(); ++b) {
+		layout.buffers[b].assign(size_t(layout.strides[b]) * layout.count, 0);
+		totalBytes += layout.buffers[b].size();
+	}
+
+	for (size_t a = 0; a < layout.attributes.size(); ++a) {
+		const VertexLayoutAttribute& attribute = layout.attributes[a];
+		unsigned int stride = layout.strides[attribute.buffer];
+		unsigned int size = componentSize(attribute.format);
+		unsigned char* out = layout.buffers[attribute.buffer].empty() ? NULL : &layout.buffers[attribute.buffer][attribute.offset];
+		const float* in = values[a].empty() ? NULL : &values[a][0];
+		for (size_t v = 0; v < layout.count; ++v, out += stride) {
+			for (unsigned int c = 0; c < attribute.components; ++c) {
+				writeComponent(out + c * size, attribute.format, *in++);
+			}
+		}
+	}
+
+	std::cout << "\n" << layout.buffers.size() << " buffer(s), " << totalBytes << " bytes ("
+		<< size_t(floatBytes) * layout.count << " as tightly packed float32).";
+	return layout;
+}
+
+Json::Value vertexLayoutToJson(const VertexLayout& layout) {
+	Json::Value root;
+	root["count"] = layout.count;
+
+	Json::Value& buffers = root.emplace("buffers", Json::Value(Json::arrayValue));
+	for (size_t b = 0; b < layout.buffers.size(); ++b) {
+		const std::vector<unsigned char>& bytes = layout.buffers[b];
+		Json::Value buffer;
+		buffer["stride"] = layout.strides[b];
+		buffer["byteLength"] = (Json::UInt)bytes.size();
+		buffer["encoding"] = "base64";
+		buffer["array"] = bytes.empty() ? std::string() : base64Encode(&bytes[0], bytes.size());
+		buffers.append(std::move(buffer));
+	}
+
+	Json::Value& attributes = root.emplace("attributes", Json::Value(Json::objectValue));
+	for (size_t a = 0; a < layout.attributes.size(); ++a) {
+		const VertexLayoutAttribute& attribute = layout.attributes[a];
+		const ComponentFormatInfo& info = componentFormats[attribute.format];
+		Json::Value description;
+		description["buffer"] = attribute.buffer;
+		description["offset"] = attribute.offset;
+		description["components"] = attribute.components;
+		description["format"] = info.name;
+		description["type"] = info.type;
+		description["normalized"] = info.normalized;
+		attributes.emplace(attribute.name.c_str(), std::move(description));
+	}
+
+	return root;
+}
@@ -0,0 +1,86 @@
+#ifndef ASSIMP_TO_JSON_VERTEX_LAYOUT_H
+#define ASSIMP_TO_JSON_VERTEX_LAYOUT_H
+
+#include <string>
+#include <vector>
+
+#include <json\json.h>
+
+#include "mesh.h"
+
+/*
+
+Packs vertex attributes into GPU-ready buffers, along with a descriptor the client can pass
+straight to vertexAttribPointer.
+
+Interleaved, every attribute goes into one buffer that is bound once, with a shared
+stride. Separate, every attribute gets its own tightly strided buffer. Each attribute
+is stored in its chosen component format. Its offset, and each stride, is padded to a
+multiple of alignment; WebGL wants 4.
+
+Attribute names are the BufferGeometry ones: position, normal, tangent, uv, skinIndex,
+skinWeight. Float formats are stored as is. Normalized formats are clamped to [-1, 1] or
+[0, 1]. Integer formats are rounded.
+
+Descriptor:
+	"count"        vertices
+	"buffers"      [{"stride", "byteLength", "encoding": "base64", "array"}]
+	"attributes"   {name: {"buffer", "offset", "components", "format", "type", "normalized"}}
+"type" is the WebGL component type enum (5126 FLOAT, 5131 HALF_FLOAT, ...) and "format"
+names the conversion.
+
+*/
+
+enum ComponentFormat {
+	ComponentFloat32,
+	ComponentFloat16,
+	ComponentSnorm16,
+	ComponentUnorm16,
+	ComponentUint16,
+	ComponentSnorm8,
+	ComponentUnorm8,
+	ComponentUint8
+};
+
+struct VertexAttributeFormat {
+	VertexAttributeFormat(const std::string& name, ComponentFormat format) : name(name), format(format) {}
+
+	std::string name;
+	ComponentFormat format;
+};
+
+struct VertexLayoutOptions {
+	VertexLayoutOptions() : interleaved(true), alignment(4) {}
+
+	bool interleaved;
+	// In buffer order. Empty exports every attribute the mesh has as float32, with
+	// skinIndex as uint16.
+	std::vector<VertexAttributeFormat> attributes;
+	unsigned int alignment;
+};
+
+struct VertexLayoutAttribute {
+	std::string name;
+	ComponentFormat format;
+	unsigned int components;
+	unsigned int buffer;
+	unsigned int offset;
+};
+
+struct VertexLayout {
+	unsigned int count;
+	std::vector<VertexLayoutAttribute> attributes;
+	std::vector<unsigned int> strides;
+	std::vector< std::vector<unsigned char> > buffers;
+};
+
+// Parses "position:float32,normal:snorm8,uv:float16". Returns false and names the bad entry in error.
+bool parseVertexFormats(const std::string& list, std::vector<VertexAttributeFormat>& formats, std::string& error);
+
+unsigned int componentSize(ComponentFormat format);
+
+VertexLayout buildVertexLayout(const Mesh& mesh, const VertexLayoutOptions& options);
+
+Json::Value vertexLayoutToJson(const VertexLayout& layout);
+
+#endif